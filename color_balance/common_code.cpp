@@ -1,4 +1,5 @@
 #include "common_code.hpp"
+#include "histogram.hpp"
 #include <opencv2/imgproc/imgproc.hpp>
 #include <iostream>
 
@@ -43,11 +44,9 @@ cv::Mat fsiv_convert_bgr_to_gray(const cv::Mat &img, cv::Mat &out)
 cv::Mat fsiv_compute_image_histogram(cv::Mat const &img)
 {
     CV_Assert(img.type() == CV_8UC1);
-    cv::Mat hist;
-    // TODO
-    // Hint: use cv::calcHist() and cv::normalize() to do the work.
-
-    //
+    // The gray levels are counted in parallel with private sub-histograms.
+    cv::Mat hist = fsiv_compute_histogram_u8(img);
+    cv::normalize(hist, hist, 1.0, 0.0, cv::NORM_L1);
     CV_Assert(!hist.empty());
     CV_Assert(hist.type() == CV_32FC1);
     CV_Assert(hist.rows == 256 && hist.cols == 1);
@@ -91,7 +90,7 @@ cv::Mat fsiv_white_patch_color_balance(cv::Mat const &in, float p)
     {
         // TODO
         // HINT: convert to GRAY color space to get the illuminance.
-        // HINT: Compute a gray level histogram to find the 100-p percentile.
+        // HINT: use fsiv_compute_image_histogram() to find the 100-p percentile.
         // HINT: use operator >= to get the mask with p% brighter pixels and use it
         //        to compute the mean value.
         // HINT: use fsiv_color_rescaling when the "from" scalar was computed.
@@ -27,7 +27,7 @@ cv::Mat fsiv_convert_bgr_to_gray(const cv::Mat &img, cv::Mat &out);
  * @brief Compute the histogram of an image.
  *
  * @param img the input image.
- * @return the histogram.
+ * @return the histogram normalized to add 1 (see fsiv_compute_histogram_u8).
  * @pre in.type()==CV_8UC1
  *
  */
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <opencv2/core/utility.hpp>
+#include "canny_hysteresis.hpp"
+
+// Rows per band labelled by a thread.
+static const int BAND_ROWS = 64;
+
+// tan(22.5) and tan(67.5) degrees, the limits of the quantized directions.
+static const float TG22 = 0.41421356f;
+static const float TG67 = 2.41421356f;
+
+/**
+ * @brief Get the root of a pixel, halving the path.
+ */
+static inline int find_root(std::vector<int> &parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+/**
+ * @brief Join the components of two pixels.
+ *
+ * The root with the greater index is linked to the other one and the strong
+ * flag of the new root is updated.
+ */
+static inline void unite(std::vector<int> &parent, std::vector<uchar> &strong,
+                         int a, int b)
+{
+    a = find_root(parent, a);
+    b = find_root(parent, b);
+    if (a == b)
+        return;
+    if (a < b)
+        std::swap(a, b);
+    parent[a] = b;
+    strong[b] |= strong[a];
+}
+
+cv::Mat fsiv_canny_non_maximum_suppression(cv::Mat const &dx, cv::Mat const &dy,
+                                           float low, float high)
+{
+    CV_Assert(dx.size() == dy.size());
+    CV_Assert(dx.type() == CV_32FC1);
+    CV_Assert(dy.type() == CV_32FC1);
+    CV_Assert(low <= high);
+
+    const int rows = dx.rows;
+    const int cols = dx.cols;
+    // Magnitude with a zero border.
+    cv::Mat mag = cv::Mat::zeros(rows + 2, cols + 2, CV_32FC1);
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range)
+    {
+        for (int y = range.start; y < range.end; ++y)
+        {
+            const float *gx = dx.ptr<float>(y);
+            const float *gy = dy.ptr<float>(y);
+            float *m = mag.ptr<float>(y + 1) + 1;
+            for (int x = 0; x < cols; ++x)
+                m[x] = std::sqrt(gx[x] * gx[x] + gy[x] * gy[x]);
+        }
+    });
+
+    cv::Mat candidates(rows, cols, CV_8UC1);
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range)
+    {
+        for (int y = range.start; y < range.end; ++y)
+        {
+            const float *gx = dx.ptr<float>(y);
+            const float *gy = dy.ptr<float>(y);
+            const float *mp = mag.ptr<float>(y) + 1;
+            const float *m = mag.ptr<float>(y + 1) + 1;
+            const float *mn = mag.ptr<float>(y + 2) + 1;
+            uchar *dst = candidates.ptr<uchar>(y);
+            for (int x = 0; x < cols; ++x)
+            {
+                const float v = m[x];
+                dst[x] = 0;
+                if (v <= low)
+                    continue;
+                const float ax = std::abs(gx[x]);
+                const float ay = std::abs(gy[x]);
+                bool is_max;
+                if (ay < TG22 * ax)
+                    is_max = v > m[x - 1] && v >= m[x + 1];
+                else if (ay > TG67 * ax)
+                    is_max = v > mp[x] && v >= mn[x];
+                else
+                {
+                    const int s = ((gx[x] < 0.0f) != (gy[x] < 0.0f)) ? -1 : 1;
+                    is_max = v > mp[x - s] && v > mn[x + s];
+                }
+                if (is_max)
+                    dst[x] = (v > high) ? 2 : 1;
+            }
+        }
+    });
+    return candidates;
+}
+
+cv::Mat fsiv_hysteresis(cv::Mat const &candidates)
+{
+    CV_Assert(candidates.type() == CV_8UC1);
+    const int rows = candidates.rows;
+    const int cols = candidates.cols;
+    std::vector<int> parent(size_t(rows) * cols);
+    std::vector<uchar> strong(parent.size());
+
+    // Label each band. The trees of a band only have pixels of the band, so
+    // the bands do not share memory.
+    const int n_bands = (rows + BAND_ROWS - 1) / BAND_ROWS;
+    cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range &range)
+    {
+        for (int b = range.start; b < range.end; ++b)
+        {
+            const int y0 = b * BAND_ROWS;
+            const int y1 = std::min(rows, y0 + BAND_ROWS);
+            for (int y = y0; y < y1; ++y)
+            {
+                const uchar *c = candidates.ptr<uchar>(y);
+                const uchar *cp = (y > y0) ? candidates.ptr<uchar>(y - 1) : nullptr;
+                for (int x = 0; x < cols; ++x)
+                {
+                    const int i = y * cols + x;
+                    parent[i] = i;
+                    strong[i] = (c[x] == 2);
+                    if (c[x] == 0)
+                        continue;
+                    if (x > 0 && c[x - 1])
+                        unite(parent, strong, i, i - 1);
+                    if (cp == nullptr)
+                        continue;
+                    for (int k = std::max(0, x - 1); k <= std::min(cols - 1, x + 1); ++k)
+                        if (cp[k])
+                            unite(parent, strong, i, i - cols + k - x);
+                }
+            }
+        }
+    });
+
+    // Merge the components across the band borders.
+    for (int b = 1; b < n_bands; ++b)
+    {
+        const int y = b * BAND_ROWS;
+        const uchar *c = candidates.ptr<uchar>(y);
+        const uchar *cp = candidates.ptr<uchar>(y - 1);
+        for (int x = 0; x < cols; ++x)
+        {
+            if (c[x] == 0)
+                continue;
+            for (int k = std::max(0, x - 1); k <= std::min(cols - 1, x + 1); ++k)
+                if (cp[k])
+                    unite(parent, strong, y * cols + x, (y - 1) * cols + k);
+        }
+    }
+
+    // A pixel is an edge if the root of its component is strong. The trees
+    // are only read, so the rows are independent.
+    cv::Mat edges(rows, cols, CV_8UC1);
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range &range)
+    {
+        for (int y = range.start; y < range.end; ++y)
+        {
+            const uchar *c = candidates.ptr<uchar>(y);
+            uchar *dst = edges.ptr<uchar>(y);
+            for (int x = 0; x < cols; ++x)
+            {
+                int i = y * cols + x;
+                if (c[x] != 0)
+                    while (parent[i] != i)
+                        i = parent[i];
+                dst[x] = (c[x] != 0 && strong[i]) ? 255 : 0;
+            }
+        }
+    });
+    CV_Assert(edges.size() == candidates.size());
+    return edges;
+}
+
+cv::Mat fsiv_sequential_hysteresis(cv::Mat const &candidates)
+{
+    CV_Assert(candidates.type() == CV_8UC1);
+    const int rows = candidates.rows;
+    const int cols = candidates.cols;
+    cv::Mat edges = cv::Mat::zeros(rows, cols, CV_8UC1);
+    std::vector<cv::Point> stack;
+    for (int y = 0; y < rows; ++y)
+        for (int x = 0; x < cols; ++x)
+        {
+            if (candidates.at<uchar>(y, x) != 2 || edges.at<uchar>(y, x))
+                continue;
+            edges.at<uchar>(y, x) = 255;
+            stack.push_back(cv::Point(x, y));
+            while (!stack.empty())
+            {
+                const cv::Point p = stack.back();
+                stack.pop_back();
+                for (int j = std::max(0, p.y - 1); j <= std::min(rows - 1, p.y + 1); ++j)
+                    for (int i = std::max(0, p.x - 1); i <= std::min(cols - 1, p.x + 1); ++i)
+                        if (candidates.at<uchar>(j, i) != 0 && !edges.at<uchar>(j, i))
+                        {
+                            edges.at<uchar>(j, i) = 255;
+                            stack.push_back(cv::Point(i, j));
+                        }
+            }
+        }
+    return edges;
+}
+
+void fsiv_union_find_canny(cv::Mat const &dx, cv::Mat const &dy, cv::Mat &edges,
+                           float low, float high)
+{
+    edges = fsiv_hysteresis(fsiv_canny_non_maximum_suppression(dx, dy, low, high));
+    CV_Assert(edges.type() == CV_8UC1);
+    CV_Assert(edges.size() == dx.size());
+}
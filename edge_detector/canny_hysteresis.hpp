@@ -0,0 +1,59 @@
+#pragma once
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Non maximum suppression and double threshold of the Canny detector.
+ *
+ * The gradient magnitude (L2 norm) of a pixel is kept if it is a maximum along
+ * the gradient direction, quantized to 0, 45, 90 or 135 degrees as cv::Canny
+ * does, and it is greater than the low threshold. Pixels outside the image
+ * have magnitude zero.
+ *
+ * @param[in] dx x axis derivate.
+ * @param[in] dy y axis derivate.
+ * @param[in] low is the low threshold (gradient value).
+ * @param[in] high is the high threshold (gradient value).
+ * @return a CV_8UC1 image with 0 (not edge), 1 (weak edge, low < m <= high)
+ *         or 2 (strong edge, m > high).
+ */
+cv::Mat fsiv_canny_non_maximum_suppression(cv::Mat const &dx, cv::Mat const &dy,
+                                           float low, float high);
+
+/**
+ * @brief Canny hysteresis with a parallel union-find.
+ *
+ * The weak and strong pixels are labelled as connected components (8
+ * neighbors) with a union-find: the rows are split in bands which are labelled
+ * in parallel, and then the components are merged across the band borders.
+ * Each root records if its component has a strong pixel, so the edges are the
+ * pixels whose component has one. The result is the same as
+ * fsiv_sequential_hysteresis.
+ *
+ * @param[in] candidates the output of fsiv_canny_non_maximum_suppression.
+ * @return the edges (CV_8UC1, 255 edge, 0 not edge).
+ */
+cv::Mat fsiv_hysteresis(cv::Mat const &candidates);
+
+/**
+ * @brief Canny hysteresis with a sequential flood fill.
+ *
+ * Reference implementation: the weak pixels connected (8 neighbors) to a
+ * strong pixel are visited from each strong pixel with a stack.
+ *
+ * @param[in] candidates the output of fsiv_canny_non_maximum_suppression.
+ * @return the edges (CV_8UC1, 255 edge, 0 not edge).
+ */
+cv::Mat fsiv_sequential_hysteresis(cv::Mat const &candidates);
+
+/**
+ * @brief Detect borders using the Canny method with a parallel hysteresis.
+ *
+ * @param[in] dx x axis derivate.
+ * @param[in] dy y axis derivate.
+ * @param[out] edges the detected borders.
+ * @param[in] low is the low threshold (gradient value).
+ * @param[in] high is the high threshold (gradient value).
+ */
+void fsiv_union_find_canny(cv::Mat const &dx, cv::Mat const &dy, cv::Mat &edges,
+                           float low, float high);
@@ -9,6 +9,9 @@
 #include <opencv2/calib3d/calib3d.hpp>
 
 #include "common_code.hpp"
+#include "canny_hysteresis.hpp"
+#include "fused_gradient.hpp"
+#include "pr_curve.hpp"
 
 const char *keys =
     "{help h usage ? |      | print this message   }"
@@ -20,6 +23,9 @@ const char *keys =
     "{th1            | 0.2  | Gradient percentile used as th1 threshold for the Canny detector (th1 < th).}"
     "{m method       | 0    | Detector used: 0:percentile detector, 1:Otsu detector, 2:canny detector}"
     "{c consensus    | 50   | If a ground truth was given, use greater to c% consensus to generate ground truth.}"
+    "{f fused        |      | Compute derivatives, gradient and histogram in a fused pass.}"
+    "{u uf_canny     |      | Canny detector with a parallel union-find hysteresis.}"
+    "{pr             |      | Print the precision-recall curve of the gradient thresholds and save the edges of the best F1 (needs ground truth, not with -i).}"
     "{@input         |<none>| input image.}"
     "{@output        |<none>| output image.}"
     "{@ground_truth  |      | optional ground truth image to compute the detector metrics.}";
@@ -39,6 +45,8 @@ struct Parameters
   int s_ap;
   int method;
   bool interactive;
+  bool fused;
+  bool uf_canny;
   float consensus;
 };
 
@@ -49,21 +57,53 @@ const char *detectors_names[] = {
 
 void do_the_process(Parameters *params)
 {
-  fsiv_compute_derivate(params->input, params->dx, params->dy, params->g_r,
-                        2 * params->s_ap + 1);
-  fsiv_compute_gradient_magnitude(params->dx, params->dy, params->gradient);
+  cv::Mat hist;
+  float max_gradient = 0.0;
+  if (params->fused)
+  {
+    // Only Canny needs the derivatives.
+    const bool canny = (params->method == 2);
+    fsiv_fused_gradient(params->input, params->g_r, 2 * params->s_ap + 1,
+                        params->n_bins, params->gradient, hist, max_gradient,
+                        canny ? &params->dx : nullptr,
+                        canny ? &params->dy : nullptr);
+  }
+  else
+  {
+    fsiv_compute_derivate(params->input, params->dx, params->dy, params->g_r,
+                          2 * params->s_ap + 1);
+    fsiv_compute_gradient_magnitude(params->dx, params->dy, params->gradient);
+  }
   switch (params->method)
   {
   case 0:
-    fsiv_percentile_edge_detector(params->gradient, params->edges,
-                                  params->th2 / 100.0, params->n_bins);
+    if (params->fused)
+      fsiv_histogram_edge_detector(params->gradient, hist, max_gradient,
+                                   params->edges, params->th2 / 100.0);
+    else
+      fsiv_percentile_edge_detector(params->gradient, params->edges,
+                                    params->th2 / 100.0, params->n_bins);
     break;
   case 1:
     fsiv_otsu_edge_detector(params->gradient, params->edges);
     break;
   case 2:
-    fsiv_canny_edge_detector(params->dx, params->dy, params->edges,
-                             params->th1 / 100.0, params->th2 / 100.0, params->n_bins);
+    if (params->uf_canny)
+    {
+      if (!params->fused)
+        fsiv_compute_gradient_histogram(params->gradient, params->n_bins, hist,
+                                        max_gradient);
+      const float low = fsiv_histogram_idx_to_value(
+          fsiv_compute_histogram_percentile(hist, params->th1 / 100.0),
+          params->n_bins, max_gradient);
+      const float high = fsiv_histogram_idx_to_value(
+          fsiv_compute_histogram_percentile(hist, params->th2 / 100.0),
+          params->n_bins, max_gradient);
+      fsiv_union_find_canny(params->dx, params->dy, params->edges, low, high);
+    }
+    else
+      fsiv_canny_edge_detector(params->dx, params->dy, params->edges,
+                               params->th1 / 100.0, params->th2 / 100.0, params->n_bins);
     break;
   default:
     throw std::runtime_error("Method not implemented.");
@@ -94,6 +134,36 @@ void do_the_process(Parameters *params)
   }
 }
 
+void do_the_sweep(Parameters *params)
+{
+  cv::Mat hist;
+  cv::Mat gt_img;
+  float max_gradient = 0.0;
+  // fsiv_compute_pr_curve bins the gradient itself, so no histogram is needed.
+  fsiv_fused_gradient(params->input, params->g_r, 2 * params->s_ap + 1,
+                      0, params->gradient, hist, max_gradient);
+  fsiv_compute_ground_truth_image(params->gt_img, params->consensus, gt_img);
+  std::vector<PRCurvePoint> curve;
+  fsiv_compute_pr_curve(params->gradient, max_gradient, gt_img, params->n_bins,
+                        curve);
+  const int best = fsiv_find_best_pr_point(curve);
+
+  std::cout << "th\tthreshold\tsensitivity\tprecision\tF1" << std::endl;
+  for (size_t i = 0; i < curve.size(); ++i)
+    std::cout << curve[i].th << '\t' << curve[i].threshold << '\t'
+              << curve[i].sensitivity << '\t' << curve[i].precision << '\t'
+              << curve[i].F1 << std::endl;
+  std::cout << std::endl;
+  std::cout << "GT consensus: " << params->consensus << "%" << std::endl;
+  std::cout << "Best th     : " << curve[best].th << std::endl;
+  std::cout << "threshold   : " << curve[best].threshold << std::endl;
+  std::cout << "sensitivity : " << curve[best].sensitivity << std::endl;
+  std::cout << "precision   : " << curve[best].precision << std::endl;
+  std::cout << "F1          : " << curve[best].F1 << std::endl;
+  fsiv_pr_curve_edges(params->gradient, max_gradient, params->n_bins, best,
+                      params->edges);
+}
+
 void onChange_s_ap(int count, void *data)
 {
   Parameters *params = reinterpret_cast<Parameters *>(data);
@@ -171,6 +241,9 @@ int main(int argc, char *const *argv)
     int method = parser.get<int>("method");
     float consensus = parser.get<float>("c");
     bool interactive = parser.has("i");
+    bool fused = parser.has("f");
+    bool pr_curve = parser.has("pr");
+    bool uf_canny = parser.has("u");
 
     if (!parser.check())
     {
@@ -178,6 +251,12 @@ int main(int argc, char *const *argv)
       return 0;
     }
 
+    if (interactive && pr_curve)
+    {
+      std::cerr << "Error: the precision-recall curve can not be computed in interactive mode." << std::endl;
+      return EXIT_FAILURE;
+    }
+
     cv::Mat img = cv::imread(input_fname, cv::IMREAD_GRAYSCALE);
     cv::Mat gt_img;
     if (gt_fname != "")
@@ -193,6 +272,8 @@ int main(int argc, char *const *argv)
     params.th2 = th2 * 100;
     params.method = method;
     params.interactive = interactive;
+    params.fused = fused;
+    params.uf_canny = uf_canny;
     params.consensus = consensus;
 
     if (interactive)
@@ -233,6 +314,16 @@ int main(int argc, char *const *argv)
       if (key != 27)
         cv::imwrite(output_fname, params.edges);
     }
+    else if (pr_curve)
+    {
+      if (params.gt_img.empty())
+      {
+        std::cerr << "Error: the precision-recall curve needs a ground truth image." << std::endl;
+        return EXIT_FAILURE;
+      }
+      do_the_sweep(&params);
+      cv::imwrite(output_fname, params.edges);
+    }
     else
     {
       do_the_process(&params);
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include "common_code.hpp"
+#include "fused_gradient.hpp"
+
+// Rows per band. The row buffers of a band must fit in the L2 cache.
+static const int BAND_ROWS = 32;
+
+/**
+ * @brief Map an index to [0, n) reflecting the borders (cv::BORDER_REFLECT_101).
+ */
+static inline int reflect_index(int i, int n)
+{
+    if (n == 1)
+        return 0;
+    while (i < 0 || i >= n)
+        i = (i < 0) ? -i : 2 * (n - 1) - i;
+    return i;
+}
+
+/**
+ * @brief Correlate a row with a 1D kernel reflecting the borders.
+ * @param src is the row.
+ * @param n is the number of values of the row.
+ * @param k is the kernel (odd size).
+ * @param ext is a buffer with n+k.rows-1 values.
+ * @param dst is the output row.
+ */
+static void filter_row(const float *src, int n, const cv::Mat &k, float *ext,
+                       float *dst)
+{
+    const int h = k.rows / 2;
+    for (int x = -h; x < n + h; ++x)
+        ext[x + h] = src[reflect_index(x, n)];
+    const float *kv = k.ptr<float>();
+    for (int x = 0; x < n; ++x)
+    {
+        float sum = 0.0f;
+        for (int i = 0; i < k.rows; ++i)
+            sum += kv[i] * ext[x + i];
+        dst[x] = sum;
+    }
+}
+
+/**
+ * @brief Correlate a column of rows with a 1D kernel.
+ * @param rows are the k.rows input rows.
+ * @param n is the number of values of a row.
+ * @param k is the kernel.
+ * @param dst is the output row.
+ */
+static void filter_column(const float *const *rows, int n, const cv::Mat &k,
+                          float *dst)
+{
+    const float *kv = k.ptr<float>();
+    std::fill(dst, dst + n, 0.0f);
+    for (int i = 0; i < k.rows; ++i)
+    {
+        const float *s = rows[i];
+        for (int x = 0; x < n; ++x)
+            dst[x] += kv[i] * s[x];
+    }
+}
+
+void fsiv_fused_gradient(cv::Mat const &img, int g_r, int s_ap, int n_bins,
+                         cv::Mat &gradient, cv::Mat &hist, float &max_gradient,
+                         cv::Mat *dx, cv::Mat *dy)
+{
+    CV_Assert(img.type() == CV_8UC1);
+    CV_Assert(g_r >= 0);
+    CV_Assert(n_bins >= 0);
+
+    const int rows = img.rows;
+    const int cols = img.cols;
+    const cv::Mat gk = cv::getGaussianKernel(2 * g_r + 1, -1, CV_32F);
+    cv::Mat dx_kx, dx_ky, dy_kx, dy_ky;
+    cv::getDerivKernels(dx_kx, dx_ky, 1, 0, s_ap, false, CV_32F);
+    cv::getDerivKernels(dy_kx, dy_ky, 0, 1, s_ap, false, CV_32F);
+    // Blurred rows needed above and below an output row.
+    const int s_r = std::max(dx_ky.rows, dy_ky.rows) / 2;
+    const int ext_size = cols + std::max(gk.rows, std::max(dx_kx.rows, dy_kx.rows));
+
+    gradient.create(rows, cols, CV_32FC1);
+    if (dx != nullptr)
+        dx->create(rows, cols, CV_32FC1);
+    if (dy != nullptr)
+        dy->create(rows, cols, CV_32FC1);
+
+    const int n_bands = (rows + BAND_ROWS - 1) / BAND_ROWS;
+    std::vector<float> band_max(n_bands, 0.0f);
+    cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range &range)
+    {
+        std::vector<float> blurred((BAND_ROWS + 2 * s_r) * cols);
+        std::vector<float> tmp(cols), ext(ext_size);
+        std::vector<float> gx(cols), gy(cols);
+        std::vector<const float *> src_rows(2 * s_r + 1);
+        for (int b = range.start; b < range.end; ++b)
+        {
+            const int y0 = b * BAND_ROWS;
+            const int y1 = std::min(rows, y0 + BAND_ROWS);
+
+            // Blurred rows [y0-s_r, y1+s_r), reflected at the image borders.
+            for (int j = y0 - s_r; j < y1 + s_r; ++j)
+            {
+                const int r = reflect_index(j, rows);
+                float *dst = &blurred[(j - y0 + s_r) * cols];
+                if (g_r == 0)
+                {
+                    const uchar *s = img.ptr<uchar>(r);
+                    std::copy(s, s + cols, dst);
+                    continue;
+                }
+                std::fill(tmp.begin(), tmp.end(), 0.0f);
+                for (int i = 0; i < gk.rows; ++i)
+                {
+                    const float kv = gk.at<float>(i);
+                    const uchar *s = img.ptr<uchar>(reflect_index(r + i - g_r, rows));
+                    for (int x = 0; x < cols; ++x)
+                        tmp[x] += kv * s[x];
+                }
+                filter_row(tmp.data(), cols, gk, ext.data(), dst);
+                for (int x = 0; x < cols; ++x)
+                    dst[x] = float(cv::saturate_cast<uchar>(dst[x]));
+            }
+
+            // Sobel derivatives and magnitude of the band.
+            float m = 0.0f;
+            for (int y = y0; y < y1; ++y)
+            {
+                const float *center = &blurred[(y - y0 + s_r) * cols];
+                for (int i = 0; i < dx_ky.rows; ++i)
+                    src_rows[i] = center + (i - dx_ky.rows / 2) * cols;
+                filter_column(src_rows.data(), cols, dx_ky, tmp.data());
+                filter_row(tmp.data(), cols, dx_kx, ext.data(), gx.data());
+                for (int i = 0; i < dy_ky.rows; ++i)
+                    src_rows[i] = center + (i - dy_ky.rows / 2) * cols;
+                filter_column(src_rows.data(), cols, dy_ky, tmp.data());
+                filter_row(tmp.data(), cols, dy_kx, ext.data(), gy.data());
+
+                float *g = gradient.ptr<float>(y);
+                for (int x = 0; x < cols; ++x)
+                {
+                    g[x] = std::sqrt(gx[x] * gx[x] + gy[x] * gy[x]);
+                    m = std::max(m, g[x]);
+                }
+                if (dx != nullptr)
+                    std::copy(gx.begin(), gx.end(), dx->ptr<float>(y));
+                if (dy != nullptr)
+                    std::copy(gy.begin(), gy.end(), dy->ptr<float>(y));
+            }
+            band_max[b] = m;
+        }
+    });
+    max_gradient = *std::max_element(band_max.begin(), band_max.end());
+    if (n_bins == 0)
+    {
+        hist.release();
+        CV_Assert(max_gradient > 0.0);
+        return;
+    }
+
+    // Histogram by bands, reading only the gradient magnitude. The bins are
+    // computed as cv::calcHist does with the range [0, max_gradient): the
+    // upper bound is excluded, so the maximum gradient is not counted.
+    std::vector<std::vector<int>> band_hist(n_bands, std::vector<int>(n_bins, 0));
+    const double scale = (max_gradient > 0.0f) ? double(n_bins) / max_gradient : 0.0;
+    cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range &range)
+    {
+        for (int b = range.start; b < range.end; ++b)
+        {
+            std::vector<int> &h = band_hist[b];
+            const int y1 = std::min(rows, (b + 1) * BAND_ROWS);
+            for (int y = b * BAND_ROWS; y < y1; ++y)
+            {
+                const float *g = gradient.ptr<float>(y);
+                for (int x = 0; x < cols; ++x)
+                {
+                    const int idx = cvFloor(g[x] * scale);
+                    if (idx < n_bins)
+                        ++h[idx];
+                }
+            }
+        }
+    });
+    hist = cv::Mat::zeros(n_bins, 1, CV_32FC1);
+    for (int b = 0; b < n_bands; ++b)
+        for (int i = 0; i < n_bins; ++i)
+            hist.at<float>(i) += float(band_hist[b][i]);
+
+    CV_Assert(gradient.size() == img.size());
+    CV_Assert(gradient.type() == CV_32FC1);
+    CV_Assert(max_gradient > 0.0);
+    CV_Assert(hist.rows == n_bins);
+}
+
+void fsiv_histogram_edge_detector(cv::Mat const &gradient, cv::Mat const &hist,
+                                  float max_gradient, cv::Mat &edges, float th)
+{
+    CV_Assert(gradient.type() == CV_32FC1);
+    const int idx = fsiv_compute_histogram_percentile(hist, th);
+    const float value = fsiv_histogram_idx_to_value(idx, hist.rows, max_gradient);
+    edges = gradient >= value;
+    CV_Assert(edges.type() == CV_8UC1);
+    CV_Assert(edges.size() == gradient.size());
+}
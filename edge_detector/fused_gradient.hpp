@@ -0,0 +1,54 @@
+#pragma once
+
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief Compute the gradient magnitude and its histogram in a fused pass.
+ *
+ * Does the same work as fsiv_compute_derivate, fsiv_compute_gradient_magnitude
+ * and fsiv_compute_gradient_histogram, but the image is processed by bands of
+ * rows: the Gaussian blur, the Sobel derivatives and the magnitude of a band
+ * are computed on row buffers that stay in cache, so the blurred image and the
+ * derivatives are never written to memory unless dx and dy are requested.
+ * The blurred values are rounded to 8 bits, approximately as cv::GaussianBlur
+ * does on a CV_8UC1 image: OpenCV uses fixed-point arithmetic, so a few blurred
+ * pixels may differ by one gray level. The borders are reflected
+ * (cv::BORDER_REFLECT_101). See bench_fused_gradient to compare it with the
+ * three pass computation.
+ *
+ * The histogram range [0, max_gradient) is only known at the end of the
+ * pass, so the histogram is accumulated afterwards by bands reading only the
+ * gradient magnitude. The bins are the ones of cv::calcHist, as used by
+ * fsiv_compute_gradient_histogram: the upper bound is excluded, so the
+ * pixels with the maximum gradient are not counted. When the histogram is not
+ * needed, n_bins 0 skips this pass. test_fused_gradient checks the gradient
+ * and the histogram against the three pass computation.
+ *
+ * @param[in] img input image.
+ * @param[in] g_r gaussian radio used to do a gaussian blur (0 means don't blur).
+ * @param[in] s_ap Sobel kernel size.
+ * @param[in] n_bins number of histogram's bins (0 means don't compute it).
+ * @param[out] gradient the gradient magnitude.
+ * @param[out] hist the gradient histogram (empty if n_bins is 0).
+ * @param[out] max_gradient maximum gradient value.
+ * @param[out] dx if not nullptr, the x axis derivate.
+ * @param[out] dy if not nullptr, the y axis derivate.
+ */
+void fsiv_fused_gradient(cv::Mat const &img, int g_r, int s_ap, int n_bins,
+                         cv::Mat &gradient, cv::Mat &hist, float &max_gradient,
+                         cv::Mat *dx = nullptr, cv::Mat *dy = nullptr);
+
+/**
+ * @brief Detect borders using the percentile method with a computed histogram.
+ *
+ * The same as fsiv_percentile_edge_detector, but reusing the histogram given
+ * by fsiv_fused_gradient.
+ *
+ * @param[in] gradient input magnitude.
+ * @param[in] hist the gradient histogram.
+ * @param[in] max_gradient maximum gradient value.
+ * @param[out] edges the detected borders.
+ * @param[in] th is the gradient percentile used as threshold.
+ */
+void fsiv_histogram_edge_detector(cv::Mat const &gradient, cv::Mat const &hist,
+                                  float max_gradient, cv::Mat &edges, float th);
@@ -0,0 +1,111 @@
+#include <algorithm>
+#include <opencv2/core/utility.hpp>
+#include "pr_curve.hpp"
+
+// Rows per band of the histogram pass.
+static const int BAND_ROWS = 32;
+
+/**
+ * @brief Get the histogram bin of a gradient value.
+ */
+static inline int gradient_bin(float g, float scale, int n_bins)
+{
+    return std::max(0, std::min(n_bins - 1, int(g * scale)));
+}
+
+void fsiv_compute_pr_curve(cv::Mat const &gradient, float max_gradient,
+                           cv::Mat const &gt, int n_bins,
+                           std::vector<PRCurvePoint> &curve)
+{
+    CV_Assert(gradient.type() == CV_32FC1);
+    CV_Assert(gt.type() == CV_8UC1);
+    CV_Assert(gt.size() == gradient.size());
+    CV_Assert(max_gradient > 0.0);
+    CV_Assert(n_bins > 0);
+
+    // Histograms of the gradient of the edge (1) and not edge (0) pixels.
+    const int rows = gradient.rows;
+    const int cols = gradient.cols;
+    const int n_bands = (rows + BAND_ROWS - 1) / BAND_ROWS;
+    std::vector<std::vector<double>> band_hist(n_bands, std::vector<double>(2 * n_bins, 0.0));
+    const float scale = n_bins / max_gradient;
+    cv::parallel_for_(cv::Range(0, n_bands), [&](const cv::Range &range)
+    {
+        for (int b = range.start; b < range.end; ++b)
+        {
+            std::vector<double> &h = band_hist[b];
+            const int y1 = std::min(rows, (b + 1) * BAND_ROWS);
+            for (int y = b * BAND_ROWS; y < y1; ++y)
+            {
+                const float *g = gradient.ptr<float>(y);
+                const uchar *l = gt.ptr<uchar>(y);
+                for (int x = 0; x < cols; ++x)
+                {
+                    h[(l[x] != 0) * n_bins + gradient_bin(g[x], scale, n_bins)] += 1.0;
+                }
+            }
+        }
+    });
+    std::vector<double> neg(n_bins, 0.0), pos(n_bins, 0.0);
+    for (int b = 0; b < n_bands; ++b)
+        for (int i = 0; i < n_bins; ++i)
+        {
+            neg[i] += band_hist[b][i];
+            pos[i] += band_hist[b][n_bins + i];
+        }
+
+    // Sweep the thresholds from the highest one, accumulating the pixels
+    // predicted as edges.
+    const double n_pixels = double(rows) * cols;
+    double P = 0.0;
+    for (int i = 0; i < n_bins; ++i)
+        P += pos[i];
+    curve.resize(n_bins);
+    double TP = 0.0, FP = 0.0;
+    for (int i = n_bins - 1; i >= 0; --i)
+    {
+        TP += pos[i];
+        FP += neg[i];
+        PRCurvePoint &p = curve[i];
+        // The percentile detector uses bin i (if it is not empty) when th is
+        // sum{h[0], ..., h[i]} / sum(h).
+        p.th = float((n_pixels - TP - FP + pos[i] + neg[i]) / n_pixels);
+        p.threshold = i * max_gradient / n_bins;
+        p.sensitivity = (P > 0.0) ? float(TP / P) : 0.0f;
+        p.precision = (TP + FP > 0.0) ? float(TP / (TP + FP)) : 0.0f;
+        p.F1 = (p.sensitivity + p.precision > 0.0f)
+                   ? 2.0f * p.sensitivity * p.precision / (p.sensitivity + p.precision)
+                   : 0.0f;
+    }
+}
+
+int fsiv_find_best_pr_point(std::vector<PRCurvePoint> const &curve)
+{
+    CV_Assert(!curve.empty());
+    int best = 0;
+    for (int i = 1; i < int(curve.size()); ++i)
+        if (curve[i].F1 > curve[best].F1)
+            best = i;
+    return best;
+}
+
+void fsiv_pr_curve_edges(cv::Mat const &gradient, float max_gradient,
+                         int n_bins, int bin, cv::Mat &edges)
+{
+    CV_Assert(gradient.type() == CV_32FC1);
+    CV_Assert(max_gradient > 0.0);
+    CV_Assert(bin >= 0 && bin < n_bins);
+
+    const float scale = n_bins / max_gradient;
+    edges.create(gradient.size(), CV_8UC1);
+    cv::parallel_for_(cv::Range(0, gradient.rows), [&](const cv::Range &range)
+    {
+        for (int y = range.start; y < range.end; ++y)
+        {
+            const float *g = gradient.ptr<float>(y);
+            uchar *e = edges.ptr<uchar>(y);
+            for (int x = 0; x < gradient.cols; ++x)
+                e[x] = (gradient_bin(g[x], scale, n_bins) >= bin) ? 255 : 0;
+        }
+    });
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/core/core.hpp>
+
+/**
+ * @brief A point of the precision-recall curve.
+ */
+typedef struct
+{
+    float th;          // gradient percentile giving this threshold (see -th).
+    float threshold;   // lower bound of the bin (see fsiv_pr_curve_edges).
+    float sensitivity; // a.k.a. recall.
+    float precision;
+    float F1;
+} PRCurvePoint;
+
+/**
+ * @brief Compute the precision-recall curve of the gradient thresholds.
+ *
+ * The gradient is binned once in two histograms, one for the edge pixels of
+ * the ground truth and one for the other pixels. Thresholding at the start of
+ * bin i predicts as edges the pixels of bins [i, n_bins), so the confusion
+ * matrices of all the thresholds are obtained from the cumulative sums of both
+ * histograms in O(n_bins).
+ *
+ * @param[in] gradient the gradient magnitude.
+ * @param[in] max_gradient maximum gradient value.
+ * @param[in] gt the ground truth (a pixel <> 0 means edge).
+ * @param[in] n_bins number of histogram's bins.
+ * @param[out] curve one point for the threshold of each bin.
+ */
+void fsiv_compute_pr_curve(cv::Mat const &gradient, float max_gradient,
+                           cv::Mat const &gt, int n_bins,
+                           std::vector<PRCurvePoint> &curve);
+
+/**
+ * @brief Find the point of a precision-recall curve with the best F1 score.
+ *
+ * @param[in] curve the precision-recall curve.
+ * @return the index of the point.
+ */
+int fsiv_find_best_pr_point(std::vector<PRCurvePoint> const &curve);
+
+/**
+ * @brief Detect the edges of a point of the precision-recall curve.
+ *
+ * The pixels are binned as in fsiv_compute_pr_curve, so the edges are exactly
+ * the pixels counted as predicted edges in the metrics of the point.
+ *
+ * @param[in] gradient the gradient magnitude.
+ * @param[in] max_gradient maximum gradient value.
+ * @param[in] n_bins number of histogram's bins.
+ * @param[in] bin the index of the point in the curve.
+ * @param[out] edges the pixels of bins [bin, n_bins).
+ */
+void fsiv_pr_curve_edges(cv::Mat const &gradient, float max_gradient,
+                         int n_bins, int bin, cv::Mat &edges);
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <exception>
+
+#include <opencv2/core/core.hpp>
+
+#include "canny_hysteresis.hpp"
+
+/**
+ * @brief Generate a random candidates map as fsiv_canny_non_maximum_suppression.
+ *
+ * The pixels are 0 (not edge), 1 (weak) or 2 (strong) with the given
+ * percentages. Besides, a weak path zigzags down the whole image, crossing all
+ * the bands of the parallel hysteresis, and only its last pixel is strong so
+ * the path is an edge only if the components are merged across the bands.
+ *
+ * @param rows is the number of rows.
+ * @param cols is the number of columns.
+ * @param weak is the percentage of weak pixels.
+ * @param strong is the percentage of strong pixels.
+ * @param rng is the random generator.
+ * @return the candidates map (CV_8UC1).
+ */
+cv::Mat random_candidates(int rows, int cols, int weak, int strong, cv::RNG &rng)
+{
+    cv::Mat candidates(rows, cols, CV_8UC1);
+    for (int y = 0; y < rows; ++y)
+        for (int x = 0; x < cols; ++x)
+        {
+            const int v = rng.uniform(0, 100);
+            candidates.at<uchar>(y, x) = (v < strong) ? 2 : ((v < strong + weak) ? 1 : 0);
+        }
+
+    int x = rng.uniform(0, cols);
+    for (int y = 0; y < rows; ++y)
+    {
+        x = std::max(0, std::min(cols - 1, x + rng.uniform(-1, 2)));
+        candidates.at<uchar>(y, x) = (y == rows - 1) ? 2 : 1;
+    }
+    return candidates;
+}
+
+/**
+ * @brief Check that the parallel and the sequential hysteresis are equal.
+ * @param name is the test label.
+ * @param candidates is the candidates map.
+ * @param tests is the test counter.
+ * @param seed is the random seed, used to name the data file of a fail.
+ * @return true if the edges are equal.
+ */
+bool test_hysteresis(const std::string &name, const cv::Mat &candidates,
+                     int tests, cv::uint64_t seed)
+{
+    std::cout << "fsiv_hysteresis (" << name << ", " << candidates.rows << "x"
+              << candidates.cols << ") ... ";
+    const cv::Mat my_edges = fsiv_sequential_hysteresis(candidates);
+    const cv::Mat your_edges = fsiv_hysteresis(candidates);
+    const int n_diff = cv::countNonZero(my_edges != your_edges);
+    if (n_diff == 0)
+    {
+        std::cout << " Ok!" << std::endl;
+        return true;
+    }
+    std::ostringstream fname;
+    fname << "test-" << tests << '-' << seed << ".xml";
+    std::cerr << "Test fail: cv::countNonZero(my_edges != your_edges)=" << n_diff
+              << " (should be 0!)" << std::endl;
+    std::cerr << "\t test data file: " << fname.str() << std::endl;
+    auto file = cv::FileStorage();
+    file.open(fname.str(), cv::FileStorage::WRITE);
+    file << "n_diff" << n_diff;
+    file << "candidates" << candidates;
+    file << "my_edges" << my_edges;
+    file << "your_edges" << your_edges;
+    file.release();
+    return false;
+}
+
+int main(int argc, char *const *argv)
+{
+    int retCode = EXIT_SUCCESS;
+    int tests_passed = 0;
+    int tests = 0;
+    cv::uint64_t seed = 0;
+    if (argc > 1)
+        seed = static_cast<cv::uint64_t>(std::atoll(argv[1]));
+    else
+        seed = cv::getTickCount();
+    std::cerr << "Random seed: " << seed << std::endl;
+    cv::RNG rng(seed);
+
+    // Sizes with one row, one column, a multiple of the band height (64) and
+    // bands cut at the bottom.
+    const int sizes[][2] = {{1, 300}, {300, 1}, {64, 50}, {128, 97}, {256, 31},
+                            {65, 40}, {200, 151}, {333, 77}};
+    // Percentages of weak and strong pixels: sparse, dense and only weak
+    // pixels joined by the path.
+    const int densities[][2] = {{20, 2}, {45, 5}, {60, 0}};
+
+    try
+    {
+        for (const auto &s : sizes)
+            for (const auto &d : densities)
+            {
+                try
+                {
+                    tests++;
+                    std::ostringstream name;
+                    name << "weak=" << d[0] << "%, strong=" << d[1] << "%";
+                    const cv::Mat candidates = random_candidates(s[0], s[1], d[0], d[1], rng);
+                    if (test_hysteresis(name.str(), candidates, tests, seed))
+                        tests_passed++;
+                }
+                catch (std::exception &e)
+                {
+                    std::cerr << "Error: " << e.what() << std::endl;
+                }
+                catch (...)
+                {
+                    std::cerr << "Error: unknown exception!!." << std::endl;
+                }
+            }
+
+        try
+        {
+            // Two weak columns crossing three bands joined at the bottom row,
+            // with the strong pixel at the top of the second one: the first
+            // column is only reached through the last band.
+            tests++;
+            cv::Mat candidates = cv::Mat::zeros(192, 8, CV_8UC1);
+            candidates.col(1).setTo(1);
+            candidates.col(6).setTo(1);
+            candidates.row(191).setTo(1);
+            candidates.at<uchar>(0, 6) = 2;
+            if (test_hysteresis("U shape", candidates, tests, seed))
+                tests_passed++;
+        }
+        catch (std::exception &e)
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            std::cerr << "Error: unknown exception!!." << std::endl;
+        }
+
+        std::cout << "You pass " << tests_passed << " of " << tests << " tests." << std::endl;
+        if (tests_passed != tests)
+            retCode = EXIT_FAILURE;
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    catch (...)
+    {
+        std::cerr << "Error: unknown exception!!." << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    return retCode;
+}
@@ -0,0 +1,188 @@
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <exception>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "fused_gradient.hpp"
+
+/**
+ * @brief Compute the derivatives with three passes over the image.
+ *
+ * As fsiv_compute_derivate: cv::GaussianBlur and cv::Sobel with the default
+ * borders (cv::BORDER_REFLECT_101).
+ *
+ * @param img is the input image.
+ * @param g_r is the gaussian radio (0 means don't blur).
+ * @param s_ap is the Sobel kernel size.
+ * @param dx is the x axis derivate.
+ * @param dy is the y axis derivate.
+ */
+static void my_derivate(const cv::Mat &img, int g_r, int s_ap, cv::Mat &dx, cv::Mat &dy)
+{
+    cv::Mat blurred;
+    if (g_r > 0)
+        cv::GaussianBlur(img, blurred, cv::Size(2 * g_r + 1, 2 * g_r + 1), 0);
+    else
+        blurred = img;
+    cv::Sobel(blurred, dx, CV_32F, 1, 0, s_ap);
+    cv::Sobel(blurred, dy, CV_32F, 0, 1, s_ap);
+}
+
+/**
+ * @brief Get the change of a derivative when the blurred image changes by one gray level.
+ * @param s_ap is the Sobel kernel size.
+ * @return the L1 norm of the Sobel kernel.
+ */
+static double my_gray_level_tolerance(int s_ap)
+{
+    cv::Mat kx, ky;
+    cv::getDerivKernels(kx, ky, 1, 0, s_ap, false, CV_32F);
+    return cv::norm(kx, cv::NORM_L1) * cv::norm(ky, cv::NORM_L1);
+}
+
+/**
+ * @brief Compare two images and save the test data if they differ more than a tolerance.
+ * @param label is the test label.
+ * @param img is the input image.
+ * @param my_out is the reference output.
+ * @param your_out is the tested output.
+ * @param tolerance is the maximum allowed absolute difference.
+ * @param tests is the test counter.
+ * @param seed is the random seed, used to name the data file of a fail.
+ * @return true if the test passes.
+ */
+static bool check(const std::string &label, const cv::Mat &img,
+                  const cv::Mat &my_out, const cv::Mat &your_out,
+                  double tolerance, int tests, cv::uint64_t seed)
+{
+    std::cout << label << " ... ";
+    const double norm_v = (my_out.size() == your_out.size())
+                              ? cv::norm(my_out, your_out, cv::NORM_INF)
+                              : -1.0;
+    if (norm_v >= 0.0 && norm_v <= tolerance)
+    {
+        std::cout << " Ok!" << std::endl;
+        return true;
+    }
+    std::ostringstream fname;
+    fname << "test-" << tests << '-' << seed << ".xml";
+    std::cerr << "Test fail: cv::norm(my_out, your_out, cv::NORM_INF)=" << norm_v
+              << " (should be <= " << tolerance << "!)" << std::endl;
+    std::cerr << "\t test data file: " << fname.str() << std::endl;
+    auto file = cv::FileStorage();
+    file.open(fname.str(), cv::FileStorage::WRITE);
+    file << "Linf" << norm_v;
+    file << "img" << img;
+    file << "my_out" << my_out;
+    file << "your_out" << your_out;
+    file.release();
+    return false;
+}
+
+int main(int argc, char *const *argv)
+{
+    int retCode = EXIT_SUCCESS;
+    int tests_passed = 0;
+    int tests = 0;
+    cv::uint64_t seed = 0;
+    if (argc > 1)
+        seed = static_cast<cv::uint64_t>(std::atoll(argv[1]));
+    else
+        seed = cv::getTickCount();
+    std::cerr << "Random seed: " << seed << std::endl;
+    cv::RNG rng(seed);
+
+    // Sizes with bands (32 rows) cut at the bottom, one band and images
+    // thinner than the filters.
+    const int sizes[][2] = {{64, 80}, {97, 61}, {33, 130}, {7, 45}};
+    const int g_radii[] = {0, 1, 2, 3};
+    const int apertures[] = {1, 3, 5};
+    const int n_bins = 100;
+
+    try
+    {
+        for (const auto &s : sizes)
+            for (int g_r : g_radii)
+                for (int s_ap : apertures)
+                {
+                    try
+                    {
+                        tests++;
+                        std::ostringstream params;
+                        params << "(" << s[0] << "x" << s[1] << ", g_r=" << g_r
+                               << ", s_ap=" << s_ap << ")";
+                        cv::Mat img(s[0], s[1], CV_8UC1);
+                        rng.fill(img, cv::RNG::UNIFORM, 0, 256);
+
+                        cv::Mat my_dx, my_dy, my_gradient;
+                        my_derivate(img, g_r, s_ap, my_dx, my_dy);
+                        cv::magnitude(my_dx, my_dy, my_gradient);
+
+                        cv::Mat your_dx, your_dy, your_gradient, your_hist;
+                        float your_max = 0.0f;
+                        fsiv_fused_gradient(img, g_r, s_ap, n_bins, your_gradient, your_hist,
+                                            your_max, &your_dx, &your_dy);
+
+                        double max_v = 0.0;
+                        cv::minMaxLoc(your_gradient, nullptr, &max_v);
+
+                        // Without blur the derivatives are exact. The blurred
+                        // values may differ by one gray level. The magnitude
+                        // may also be rounded differently.
+                        const double d_tolerance = (g_r == 0) ? 0.0 : my_gray_level_tolerance(s_ap);
+                        const double g_tolerance = std::sqrt(2.0) * d_tolerance + 1.0e-6 * max_v;
+
+                        // The histogram is the one cv::calcHist gives with the
+                        // range [0, max_gradient).
+                        const int channels[] = {0};
+                        const int hist_size[] = {n_bins};
+                        const float range[] = {0.0f, float(max_v)};
+                        const float *ranges[] = {range};
+                        cv::Mat my_hist;
+                        cv::calcHist(&your_gradient, 1, channels, cv::Mat(), my_hist, 1,
+                                     hist_size, ranges);
+
+                        if (check("fsiv_fused_gradient dx " + params.str(), img,
+                                  my_dx, your_dx, d_tolerance, tests, seed) &&
+                            check("fsiv_fused_gradient dy " + params.str(), img,
+                                  my_dy, your_dy, d_tolerance, tests, seed) &&
+                            check("fsiv_fused_gradient gradient " + params.str(), img,
+                                  my_gradient, your_gradient, g_tolerance, tests, seed) &&
+                            check("fsiv_fused_gradient max_gradient " + params.str(), img,
+                                  cv::Mat(1, 1, CV_64FC1, cv::Scalar(max_v)),
+                                  cv::Mat(1, 1, CV_64FC1, cv::Scalar(your_max)), 0.0, tests, seed) &&
+                            check("fsiv_fused_gradient histogram " + params.str(), img,
+                                  my_hist, your_hist, 0.0, tests, seed))
+                            tests_passed++;
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "Error: unknown exception!!." << std::endl;
+                    }
+                }
+
+        std::cout << "You pass " << tests_passed << " of " << tests << " tests." << std::endl;
+        if (tests_passed != tests)
+            retCode = EXIT_FAILURE;
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    catch (...)
+    {
+        std::cerr << "Error: unknown exception!!." << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    return retCode;
+}
@@ -0,0 +1,119 @@
+#include <iostream>
+#include <exception>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "histogram.hpp"
+
+const cv::String keys =
+    "{help h usage ? |      | Print this message.}"
+    "{n repetitions  |20    | Number of times each histogram is computed.}"
+    "{m mask         |      | Also measure with a mask selecting half of the pixels.}";
+
+/**
+ * @brief Compute the histogram of an image with cv::calcHist().
+ * @param in is the input image.
+ * @param mask is the mask or an empty Mat.
+ * @return the histogram.
+ */
+cv::Mat calc_hist(const cv::Mat &in, const cv::Mat &mask)
+{
+  cv::Mat hist;
+  const int channels[] = {0};
+  const int hist_size[] = {256};
+  const float range[] = {0.0f, 256.0f};
+  const float *ranges[] = {range};
+  cv::calcHist(&in, 1, channels, mask, hist, 1, hist_size, ranges);
+  return hist;
+}
+
+/**
+ * @brief Measure both histogram functions on an image and print the results.
+ * @param name is the image size label.
+ * @param in is the input image.
+ * @param mask is the mask or an empty Mat.
+ * @param repetitions is the number of times each histogram is computed.
+ * @return true if both histograms are equal.
+ */
+bool bench(const std::string &name, const cv::Mat &in, const cv::Mat &mask, int repetitions)
+{
+  cv::Mat ref, hist;
+  cv::TickMeter calc_timer, fsiv_timer;
+  for (int i = 0; i < repetitions; ++i)
+  {
+    calc_timer.start();
+    ref = calc_hist(in, mask);
+    calc_timer.stop();
+
+    fsiv_timer.start();
+    hist = fsiv_compute_histogram_u8(in, mask);
+    fsiv_timer.stop();
+  }
+  const double mpixels = double(in.total()) * repetitions / 1.0e6;
+  const bool equal = cv::norm(ref, hist, cv::NORM_INF) == 0.0;
+  std::cout << name << (mask.empty() ? "" : " (mask)") << ": "
+            << in.cols << "x" << in.rows << std::endl;
+  std::cout << "  cv::calcHist              : " << calc_timer.getTimeMilli() / repetitions
+            << " ms, " << mpixels / calc_timer.getTimeSec() << " Mpx/s" << std::endl;
+  std::cout << "  fsiv_compute_histogram_u8 : " << fsiv_timer.getTimeMilli() / repetitions
+            << " ms, " << mpixels / fsiv_timer.getTimeSec() << " Mpx/s" << std::endl;
+  std::cout << "  speedup                   : " << calc_timer.getTimeSec() / fsiv_timer.getTimeSec()
+            << (equal ? "" : "  ERROR: the histograms are different!") << std::endl;
+  return equal;
+}
+
+int main(int argc, char *const *argv)
+{
+  int retCode = EXIT_SUCCESS;
+
+  try
+  {
+    cv::CommandLineParser parser(argc, argv, keys);
+    parser.about("Benchmark the histogram function against cv::calcHist. (ver 1.0.0)");
+    if (parser.has("help"))
+    {
+      parser.printMessage();
+      return 0;
+    }
+
+    int repetitions = parser.get<int>("n");
+    bool use_mask = parser.has("m");
+
+    if (!parser.check())
+    {
+      parser.printErrors();
+      return 0;
+    }
+
+    std::cout << "Threads: " << cv::getNumThreads() << std::endl;
+    const cv::Size sizes[] = {cv::Size(3840, 2160), cv::Size(7680, 4320)};
+    const char *names[] = {"4K", "8K"};
+    cv::RNG rng(0);
+    for (int i = 0; i < 2; ++i)
+    {
+      cv::Mat in(sizes[i], CV_8UC1);
+      rng.fill(in, cv::RNG::UNIFORM, 0, 256);
+      if (!bench(names[i], in, cv::Mat(), std::max(1, repetitions)))
+        retCode = EXIT_FAILURE;
+      if (use_mask)
+      {
+        cv::Mat mask = in >= 128;
+        if (!bench(names[i], in, mask, std::max(1, repetitions)))
+          retCode = EXIT_FAILURE;
+      }
+    }
+  }
+  catch (std::exception &e)
+  {
+    std::cerr << "Capturada excepcion: " << e.what() << std::endl;
+    retCode = EXIT_FAILURE;
+  }
+  catch (...)
+  {
+    std::cerr << "Capturada excepcion desconocida!" << std::endl;
+    retCode = EXIT_FAILURE;
+  }
+  return retCode;
+}
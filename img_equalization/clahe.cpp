@@ -10,134 +10,523 @@
  */
 #include "clahe.hpp"
 #include "common_code.hpp"
+#include "histogram.hpp"
+#include "lut.hpp"
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/core/hal/intrin.hpp>
 #include <opencv2/imgproc.hpp>
 
-static uchar interpolate_corner(const cv::Mat &in,
-                                const std::vector<cv::Mat> &lkts, const cv::Point &p,
-                                const cv::Size &cell_size, const cv::Size &grid_size)
+/**
+ * @brief Span of image positions sharing the same neighbouring cells.
+ *
+ * Between two consecutive cell centers the positions are interpolated using
+ * the transforms of both cells (inner span). Before the first center and
+ * after the last one only one cell is used (border span).
+ */
+struct InterpolationSpan
 {
-    const int x_off = (cell_size.width + 1) >> 1;
-    const int y_off = (cell_size.height + 1) >> 1;
+    int begin; // first position of the span.
+    int end;   // one past the last position of the span.
+    int cell1; // first neighbouring cell.
+    int cell2; // second neighbouring cell (equal to cell1 for border spans).
+    bool inner;
+};
 
-    CV_Assert((p.x < x_off && p.y < y_off) ||
-              (p.x < x_off && p.y >= (in.rows - y_off - 1)) ||
-              (p.x >= (in.cols - x_off - 1) && p.y < x_off) ||
-              (p.x >= (in.cols - x_off - 1) && p.y >= (in.rows - y_off - 1)));
+static void add_interpolation_span(std::vector<InterpolationSpan> &spans,
+                                   int begin, int end, int cell1, int cell2,
+                                   bool inner, int length)
+{
+    end = std::min(end, length);
+    if (begin < end)
+    {
+        InterpolationSpan span = {begin, end, cell1, cell2, inner};
+        spans.push_back(span);
+    }
+}
 
-    const int cell_y = p.y / cell_size.height;
-    const int cell_x = p.x / cell_size.width;
-    const int h_idx = cell_y * grid_size.width + cell_x;
-    uchar out = lkts[h_idx].at<uchar>(in.at<uchar>(p));
-    return out;
+/**
+ * @brief Split an image axis into interpolation spans.
+ * @param length is the axis length of the output image.
+ * @param padded_length is the axis length of the image extended to be a
+ *        multiple of the cell length.
+ * @param cell_length is the cell length. It must be odd.
+ * @return the spans covering the range [0, length).
+ */
+static std::vector<InterpolationSpan>
+compute_interpolation_spans(int length, int padded_length, int cell_length)
+{
+    CV_Assert((cell_length & 1) == 1);
+    const int off = cell_length >> 1;
+    const int n_cells = padded_length / cell_length;
+    const int inner_end = padded_length - off - 1;
+    std::vector<InterpolationSpan> spans;
+    add_interpolation_span(spans, 0, off, 0, 0, false, length);
+    for (int c = 0; c + 1 < n_cells; ++c)
+        add_interpolation_span(spans, off + c * cell_length,
+                               off + (c + 1) * cell_length, c, c + 1, true,
+                               length);
+    add_interpolation_span(spans, std::max(off, inner_end), padded_length,
+                           n_cells - 1, n_cells - 1, false, length);
+    return spans;
 }
 
-static uchar linear_interpolate_rows(const cv::Mat &in,
-                                     const std::vector<cv::Mat> &lkts, const cv::Point &p,
-                                     const cv::Size &cell_size, const cv::Size &grid_size)
-{
-    const int x_off = cell_size.width >> 1;
-    const int y_off = cell_size.height >> 1;
-    CV_Assert(p.x >= x_off && p.x < (in.cols - x_off - 1) &&
-              ((p.y < y_off) || p.y >= (in.rows - y_off - 1)));
-
-    const int cell_y = (p.y - y_off) / cell_size.height;
-    int cell1_x = (p.x - x_off) / cell_size.width;
-    const int cell2_x = cell1_x + 1;
-    const float center2_x = cell2_x * cell_size.width + x_off;
-    const float w1 = (center2_x - p.x) / cell_size.width;
-    const float w2 = 1.0 - w1;
-    const int idx1 = cell_y * grid_size.width + cell1_x;
-    const int idx2 = cell_y * grid_size.width + cell2_x;
-    const uchar in_v = in.at<uchar>(p);
-    uchar out = w1 * lkts[idx1].at<uchar>(in_v) +
-                w2 * lkts[idx2].at<uchar>(in_v);
-    return out;
+/**
+ * @brief Compute the weight ramp of the first cell for the inner spans.
+ *
+ * The weight is the distance to the second cell center normalized by the
+ * cell length. Border positions get a zero weight because they are not used.
+ */
+static void compute_interpolation_weights(const std::vector<InterpolationSpan> &spans,
+                                          int cell_length, std::vector<float> &w1,
+                                          std::vector<float> &w2)
+{
+    const int off = cell_length >> 1;
+    const int length = spans.empty() ? 0 : spans.back().end;
+    w1.assign(length, 0.0f);
+    w2.assign(length, 0.0f);
+    for (size_t i = 0; i < spans.size(); ++i)
+    {
+        if (!spans[i].inner)
+            continue;
+        const float center2 = spans[i].cell2 * cell_length + off;
+        for (int p = spans[i].begin; p < spans[i].end; ++p)
+        {
+            w1[p] = (center2 - p) / cell_length;
+            w2[p] = 1.0f - w1[p];
+        }
+    }
 }
 
-static uchar linear_interpolate_cols(const cv::Mat &in,
-                                     const std::vector<cv::Mat> &lkts, const cv::Point &p,
-                                     const cv::Size &cell_size, const cv::Size &grid_size)
+static void interpolate_corner(const uchar *in, uchar *out, int n,
+                               const uchar *lkt)
 {
-    const int x_off = cell_size.width >> 1;
-    const int y_off = cell_size.height >> 1;
+    for (int x = 0; x < n; ++x)
+        out[x] = lkt[in[x]];
+}
 
-    CV_Assert(p.y >= y_off && p.y < (in.rows - y_off - 1) &&
-              ((p.x < x_off) || p.x >= (in.cols - x_off - 1)));
+/**
+ * @brief Interpolate two transforms with per position weights.
+ *
+ * The transform values are gathered with scalar loads, because there is no
+ * byte gather, and the weights are applied four positions at a time. The
+ * operations are the same as in the scalar loop, so the result is the same.
+ */
+static void linear_interpolate_rows(const uchar *in, uchar *out, int n,
+                                    const float *w1, const float *w2,
+                                    const uchar *lkt1, const uchar *lkt2)
+{
+    int x = 0;
+#if CV_SIMD128
+    float a[8], b[8];
+    for (; x <= n - 8; x += 8)
+    {
+        for (int k = 0; k < 8; ++k)
+        {
+            const uchar in_v = in[x + k];
+            a[k] = lkt1[in_v];
+            b[k] = lkt2[in_v];
+        }
+        const cv::v_int32x4 s0 = cv::v_trunc(cv::v_load(w1 + x) * cv::v_load(a) +
+                                             cv::v_load(w2 + x) * cv::v_load(b));
+        const cv::v_int32x4 s1 = cv::v_trunc(cv::v_load(w1 + x + 4) * cv::v_load(a + 4) +
+                                             cv::v_load(w2 + x + 4) * cv::v_load(b + 4));
+        cv::v_pack_u_store(out + x, cv::v_pack(s0, s1));
+    }
+#endif
+    for (; x < n; ++x)
+    {
+        const uchar in_v = in[x];
+        out[x] = static_cast<uchar>(w1[x] * lkt1[in_v] + w2[x] * lkt2[in_v]);
+    }
+}
 
-    const int cell_x = p.x / cell_size.width;
-    int cell1_y = (p.y - y_off) / cell_size.height;
-    const int cell2_y = cell1_y + 1;
-    const float center2_y = cell2_y * cell_size.height + y_off;
-    const float w1 = (center2_y - p.y) / cell_size.height;
-    const float w2 = 1.0 - w1;
-    const int idx1 = cell1_y * grid_size.width + cell_x;
-    const int idx2 = cell2_y * grid_size.width + cell_x;
-    const uchar in_v = in.at<uchar>(p);
-    uchar out = w1 * lkts[idx1].at<uchar>(in_v) +
-                w2 * lkts[idx2].at<uchar>(in_v);
-    return out;
+/**
+ * @brief Interpolate two transforms with the same weights for all the positions.
+ * @see linear_interpolate_rows
+ */
+static void linear_interpolate_cols(const uchar *in, uchar *out, int n,
+                                    float w1, float w2,
+                                    const uchar *lkt1, const uchar *lkt2)
+{
+    int x = 0;
+#if CV_SIMD128
+    const cv::v_float32x4 v_w1 = cv::v_setall_f32(w1);
+    const cv::v_float32x4 v_w2 = cv::v_setall_f32(w2);
+    float a[8], b[8];
+    for (; x <= n - 8; x += 8)
+    {
+        for (int k = 0; k < 8; ++k)
+        {
+            const uchar in_v = in[x + k];
+            a[k] = lkt1[in_v];
+            b[k] = lkt2[in_v];
+        }
+        const cv::v_int32x4 s0 = cv::v_trunc(v_w1 * cv::v_load(a) + v_w2 * cv::v_load(b));
+        const cv::v_int32x4 s1 = cv::v_trunc(v_w1 * cv::v_load(a + 4) + v_w2 * cv::v_load(b + 4));
+        cv::v_pack_u_store(out + x, cv::v_pack(s0, s1));
+    }
+#endif
+    for (; x < n; ++x)
+    {
+        const uchar in_v = in[x];
+        out[x] = static_cast<uchar>(w1 * lkt1[in_v] + w2 * lkt2[in_v]);
+    }
+}
+
+static void bilinear_interpolate(const uchar *in, uchar *out, int n,
+                                 const float *w_x, const float *w_x2,
+                                 float w_y, float w_y2,
+                                 const uchar *lkt11, const uchar *lkt12,
+                                 const uchar *lkt21, const uchar *lkt22)
+{
+    int x = 0;
+#if CV_SIMD128
+    const cv::v_float32x4 v_w_y = cv::v_setall_f32(w_y);
+    const cv::v_float32x4 v_w_y2 = cv::v_setall_f32(w_y2);
+    float a11[8], a12[8], a21[8], a22[8];
+    for (; x <= n - 8; x += 8)
+    {
+        for (int k = 0; k < 8; ++k)
+        {
+            const uchar in_v = in[x + k];
+            a11[k] = lkt11[in_v];
+            a12[k] = lkt12[in_v];
+            a21[k] = lkt21[in_v];
+            a22[k] = lkt22[in_v];
+        }
+        cv::v_int32x4 s[2];
+        for (int h = 0; h < 2; ++h)
+        {
+            const cv::v_float32x4 v_w_x = cv::v_load(w_x + x + 4 * h);
+            const cv::v_float32x4 v_w_x2 = cv::v_load(w_x2 + x + 4 * h);
+            const cv::v_float32x4 out_x1 = v_w_x * cv::v_load(a11 + 4 * h) +
+                                           v_w_x2 * cv::v_load(a12 + 4 * h);
+            const cv::v_float32x4 out_x2 = v_w_x * cv::v_load(a21 + 4 * h) +
+                                           v_w_x2 * cv::v_load(a22 + 4 * h);
+            s[h] = cv::v_round(v_w_y * out_x1 + v_w_y2 * out_x2);
+        }
+        cv::v_pack_u_store(out + x, cv::v_pack(s[0], s[1]));
+    }
+#endif
+    for (; x < n; ++x)
+    {
+        const uchar in_v = in[x];
+        const float out_x1 = w_x[x] * lkt11[in_v] + w_x2[x] * lkt12[in_v];
+        const float out_x2 = w_x[x] * lkt21[in_v] + w_x2[x] * lkt22[in_v];
+        out[x] = cv::saturate_cast<uchar>(w_y * out_x1 + w_y2 * out_x2);
+    }
 }
 
-static uchar bilinear_interpolate(const cv::Mat &in,
-                                  const std::vector<cv::Mat> &lkts, const cv::Point &p,
-                                  const cv::Size &cell_size, const cv::Size &grid_size)
-{
-    const int x_off = cell_size.width >> 1;
-    const int y_off = cell_size.height >> 1;
-    CV_Assert(p.y >= y_off && p.y < (in.rows - y_off - 1) &&
-              p.x >= x_off && p.x < (in.cols - x_off - 1));
-
-    const int cell1_x = (p.x - x_off) / cell_size.width;
-    const int cell1_y = (p.y - y_off) / cell_size.height;
-    const int cell2_x = cell1_x + 1;
-    const int cell2_y = cell1_y;
-    const int cell3_x = cell1_x + 1;
-    const int cell3_y = cell1_y + 1;
-    const int cell4_x = cell1_x;
-    const int cell4_y = cell1_y + 1;
-    const float center3_x = cell3_x * cell_size.width + x_off;
-    const float center3_y = cell3_y * cell_size.height + y_off;
-    const int idx11 = cell1_y * grid_size.width + cell1_x;
-    const int idx12 = cell2_y * grid_size.width + cell2_x;
-    const int idx22 = cell3_y * grid_size.width + cell3_x;
-    const int idx21 = cell4_y * grid_size.width + cell4_x;
-    const uchar in_v = in.at<uchar>(p);
-    const uchar q11 = lkts[idx11].at<uchar>(in_v);
-    const uchar q12 = lkts[idx12].at<uchar>(in_v);
-    const uchar q22 = lkts[idx22].at<uchar>(in_v);
-    const uchar q21 = lkts[idx21].at<uchar>(in_v);
-    const float w_x = (center3_x - p.x) / cell_size.width;
-    const float out_x1 = w_x * q11 + (1.0f - w_x) * q12;
-    const float out_x2 = w_x * q21 + (1.0f - w_x) * q22;
-    const float w_y = (center3_y - p.y) / cell_size.height;
-    const uchar out = cv::saturate_cast<uchar>(w_y * out_x1 + (1.0f - w_y) * out_x2);
+/**
+ * @brief Extend an image to be a multiple of the cell size.
+ * @param in is the input image.
+ * @param cell_size is the cell size.
+ * @return the input image if it is already a multiple of the cell size, else
+ *         a copy extended with reflected borders.
+ */
+static cv::Mat extend_to_cell_multiple(const cv::Mat &in, const cv::Size &cell_size)
+{
+    cv::Mat out = in;
+    if ((in.rows % cell_size.height) != 0 || (in.cols % cell_size.width) != 0)
+    {
+        out = cv::Mat(in.rows + cell_size.height - (in.rows % cell_size.height),
+                      in.cols + cell_size.width - (in.cols % cell_size.width), in.type());
+        cv::copyMakeBorder(in, out, 0, cell_size.height - (in.rows % cell_size.height),
+                           0, cell_size.width - (in.cols % cell_size.width), cv::BORDER_REFLECT101);
+    }
     return out;
 }
 
-static uchar compute_interpolate_value(const cv::Mat &in,
-                                       const std::vector<cv::Mat> &lkts, const cv::Point &p,
-                                       const cv::Size &cell_size, const cv::Size &grid_size)
+/**
+ * @brief Get the image area of a cell.
+ * @param idx is the cell index in row major order.
+ * @param cell_size is the cell size.
+ * @param grid_size is the number of cells.
+ * @return the cell rectangle.
+ */
+static cv::Rect cell_rect(int idx, const cv::Size &cell_size, const cv::Size &grid_size)
 {
-    uchar out = in.at<uchar>(p);
-    const int x_off = cell_size.width >> 1;
-    const int y_off = cell_size.height >> 1;
+    return cv::Rect((idx % grid_size.width) * cell_size.width,
+                    (idx / grid_size.width) * cell_size.height,
+                    cell_size.width, cell_size.height);
+}
 
-    if (p.y >= y_off && p.y < (in.rows - y_off - 1) &&
-        p.x >= x_off && p.x < (in.cols - x_off - 1))
-        out = bilinear_interpolate(in, lkts, p, cell_size, grid_size);
-    else if (p.y >= y_off && p.y < (in.rows - y_off - 1) &&
-             ((p.x < x_off) || p.x >= (in.cols - x_off - 1)))
-        out = linear_interpolate_cols(in, lkts, p, cell_size, grid_size);
-    else if (p.x >= x_off && p.x < (in.cols - x_off - 1) &&
-             ((p.y < y_off) || p.y >= (in.rows - y_off - 1)))
-        out = linear_interpolate_rows(in, lkts, p, cell_size, grid_size);
-    else
-        out = interpolate_corner(in, lkts, p, cell_size, grid_size);
-    return out;
+/**
+ * @brief Compute the equalization transform of each image cell.
+ *
+ * The cells are independent, so their histograms and transforms are computed
+ * in parallel.
+ *
+ * @param in is the input image extended to be a multiple of the cell size.
+ * @param s is the slope factor that controls the contrast limitation.
+ * @param cell_size is the cell size.
+ * @param grid_size is the number of cells.
+ * @return a CV_8UC1 table with a row of 256 values per cell in row major order.
+ */
+static cv::Mat compute_tile_lookup_tables(const cv::Mat &in, float s,
+                                          const cv::Size &cell_size,
+                                          const cv::Size &grid_size)
+{
+    cv::Mat lkts(grid_size.area(), 256, CV_8UC1);
+    cv::parallel_for_(cv::Range(0, grid_size.area()), [&](const cv::Range &range)
+    {
+        for (int idx = range.start; idx < range.end; ++idx)
+        {
+            const cv::Mat hist = fsiv_compute_histogram_u8(in(cell_rect(idx, cell_size, grid_size)));
+            const cv::Mat lkt = fsiv_create_equalization_lookup_table(hist, s);
+            lkt.reshape(1, 1).copyTo(lkts.row(idx));
+        }
+    });
+    return lkts;
+}
+
+/**
+ * @brief Interpolate the cell transforms on an image row.
+ * @param in_row is the input row (extended to be a multiple of the cell size).
+ * @param out_row is the output row.
+ * @param ys is the row interpolation span containing the row.
+ * @param w_y is the weight of the first cell row.
+ * @param w_y2 is the weight of the second cell row.
+ * @param lkts1 are the transforms of the first cell row, 256 values per cell.
+ * @param lkts2 are the transforms of the second cell row, 256 values per cell.
+ * @param col_spans are the column interpolation spans.
+ * @param w_x are the weights of the first cell column.
+ * @param w_x2 are the weights of the second cell column.
+ */
+static void interpolate_row(const uchar *in_row, uchar *out_row,
+                            const InterpolationSpan &ys, float w_y, float w_y2,
+                            const uchar *lkts1, const uchar *lkts2,
+                            const std::vector<InterpolationSpan> &col_spans,
+                            const std::vector<float> &w_x, const std::vector<float> &w_x2)
+{
+    for (size_t j = 0; j < col_spans.size(); ++j)
+    {
+        const InterpolationSpan &xs = col_spans[j];
+        const uchar *lkt11 = lkts1 + xs.cell1 * 256;
+        const uchar *lkt12 = lkts1 + xs.cell2 * 256;
+        const uchar *lkt21 = lkts2 + xs.cell1 * 256;
+        const uchar *lkt22 = lkts2 + xs.cell2 * 256;
+        const int n = xs.end - xs.begin;
+        const uchar *in_span = in_row + xs.begin;
+        uchar *out_span = out_row + xs.begin;
+        if (ys.inner && xs.inner)
+            bilinear_interpolate(in_span, out_span, n, &w_x[xs.begin],
+                                 &w_x2[xs.begin], w_y, w_y2,
+                                 lkt11, lkt12, lkt21, lkt22);
+        else if (ys.inner)
+            linear_interpolate_cols(in_span, out_span, n, w_y, w_y2,
+                                    lkt11, lkt21);
+        else if (xs.inner)
+            linear_interpolate_rows(in_span, out_span, n, &w_x[xs.begin],
+                                    &w_x2[xs.begin], lkt11, lkt12);
+        else
+            interpolate_corner(in_span, out_span, n, lkt11);
+    }
+}
+
+// Fixed point weights have FIXED_POINT_BITS fractional bits.
+static const int FIXED_POINT_BITS = 14;
+static const int FIXED_POINT_ONE = 1 << FIXED_POINT_BITS;
+
+/**
+ * @brief Interpolate two transforms with fixed point weights.
+ *
+ * out[x] = round(w[2x]*lkt1[in[x]] + w[2x+1]*lkt2[in[x]]).
+ *
+ * @param w are the interleaved weights of each position with FIXED_POINT_BITS
+ *        fractional bits. Each pair must add FIXED_POINT_ONE.
+ */
+static void fixed_interpolate_pairs(const uchar *in, uchar *out, int n, const short *w,
+                                    const uchar *lkt1, const uchar *lkt2)
+{
+    int x = 0;
+#if CV_SIMD128
+    const cv::v_int32x4 half = cv::v_setall_s32(FIXED_POINT_ONE >> 1);
+    short a[16];
+    for (; x <= n - 8; x += 8)
+    {
+        for (int k = 0; k < 8; ++k)
+        {
+            a[2 * k] = lkt1[in[x + k]];
+            a[2 * k + 1] = lkt2[in[x + k]];
+        }
+        const cv::v_int32x4 s0 =
+            cv::v_dotprod(cv::v_load(a), cv::v_load(w + 2 * x)) + half;
+        const cv::v_int32x4 s1 =
+            cv::v_dotprod(cv::v_load(a + 8), cv::v_load(w + 2 * x + 8)) + half;
+        cv::v_pack_u_store(out + x, cv::v_pack(cv::v_shr<FIXED_POINT_BITS>(s0),
+                                               cv::v_shr<FIXED_POINT_BITS>(s1)));
+    }
+#endif
+    for (; x < n; ++x)
+    {
+        const uchar in_v = in[x];
+        out[x] = static_cast<uchar>((w[2 * x] * lkt1[in_v] + w[2 * x + 1] * lkt2[in_v] +
+                                     (FIXED_POINT_ONE >> 1)) >> FIXED_POINT_BITS);
+    }
+}
+
+/**
+ * @brief Interpolate four transforms with fixed point weights.
+ *
+ * out[x] = round(w1[2x]*lkt11[in[x]] + w1[2x+1]*lkt12[in[x]] +
+ *                w2[2x]*lkt21[in[x]] + w2[2x+1]*lkt22[in[x]]).
+ *
+ * @param w1 are the interleaved weights of the first cell row.
+ * @param w2 are the interleaved weights of the second cell row. The four
+ *        weights of each position must add FIXED_POINT_ONE.
+ */
+static void fixed_interpolate_quads(const uchar *in, uchar *out, int n,
+                                    const short *w1, const short *w2,
+                                    const uchar *lkt11, const uchar *lkt12,
+                                    const uchar *lkt21, const uchar *lkt22)
+{
+    int x = 0;
+#if CV_SIMD128
+    const cv::v_int32x4 half = cv::v_setall_s32(FIXED_POINT_ONE >> 1);
+    short a[16], b[16];
+    for (; x <= n - 8; x += 8)
+    {
+        for (int k = 0; k < 8; ++k)
+        {
+            const uchar in_v = in[x + k];
+            a[2 * k] = lkt11[in_v];
+            a[2 * k + 1] = lkt12[in_v];
+            b[2 * k] = lkt21[in_v];
+            b[2 * k + 1] = lkt22[in_v];
+        }
+        const cv::v_int32x4 s0 = cv::v_dotprod(cv::v_load(a), cv::v_load(w1 + 2 * x)) +
+                             cv::v_dotprod(cv::v_load(b), cv::v_load(w2 + 2 * x)) + half;
+        const cv::v_int32x4 s1 = cv::v_dotprod(cv::v_load(a + 8), cv::v_load(w1 + 2 * x + 8)) +
+                             cv::v_dotprod(cv::v_load(b + 8), cv::v_load(w2 + 2 * x + 8)) + half;
+        cv::v_pack_u_store(out + x, cv::v_pack(cv::v_shr<FIXED_POINT_BITS>(s0),
+                                               cv::v_shr<FIXED_POINT_BITS>(s1)));
+    }
+#endif
+    for (; x < n; ++x)
+    {
+        const uchar in_v = in[x];
+        out[x] = static_cast<uchar>((w1[2 * x] * lkt11[in_v] + w1[2 * x + 1] * lkt12[in_v] +
+                                     w2[2 * x] * lkt21[in_v] + w2[2 * x + 1] * lkt22[in_v] +
+                                     (FIXED_POINT_ONE >> 1)) >> FIXED_POINT_BITS);
+    }
+}
+
+/**
+ * @brief Interpolate the cell transforms on an image row using fixed point weights.
+ *
+ * The weights of an inner span only depend on the offset from its begin, so
+ * they are tabulated once per row for the offsets [0, cell_width).
+ *
+ * @param in_row is the input row (extended to be a multiple of the cell size).
+ * @param out_row is the output row.
+ * @param ys is the row interpolation span containing the row.
+ * @param w_y is the weight of the first cell row.
+ * @param lkts1 are the transforms of the first cell row, 256 values per cell.
+ * @param lkts2 are the transforms of the second cell row, 256 values per cell.
+ * @param col_spans are the column interpolation spans.
+ * @param cell_width is the cell width.
+ */
+static void fixed_interpolate_row(const uchar *in_row, uchar *out_row,
+                                  const InterpolationSpan &ys, float w_y,
+                                  const uchar *lkts1, const uchar *lkts2,
+                                  const std::vector<InterpolationSpan> &col_spans,
+                                  int cell_width)
+{
+    const int wy1 = ys.inner ? cvRound(w_y * FIXED_POINT_ONE) : FIXED_POINT_ONE;
+    const int wy2 = FIXED_POINT_ONE - wy1;
+    // Interleaved weights per offset: columns (wx_1, wx_2), rows (wy_1, wy_2)
+    // and bilinear (wy_1*wx_1, wy_1*wx_2) and (wy_2*wx_1, wy_2*wx_2).
+    std::vector<short> w_x(2 * cell_width), w_c(2 * cell_width);
+    std::vector<short> w_r1(2 * cell_width), w_r2(2 * cell_width);
+    for (int o = 0; o < cell_width; ++o)
+    {
+        const int wx1 = cvRound(float(cell_width - o) / cell_width * FIXED_POINT_ONE);
+        w_x[2 * o] = short(wx1);
+        w_x[2 * o + 1] = short(FIXED_POINT_ONE - wx1);
+        w_c[2 * o] = short(wy1);
+        w_c[2 * o + 1] = short(wy2);
+        const int w11 = (wy1 * wx1 + (FIXED_POINT_ONE >> 1)) >> FIXED_POINT_BITS;
+        const int w21 = (wy2 * wx1 + (FIXED_POINT_ONE >> 1)) >> FIXED_POINT_BITS;
+        w_r1[2 * o] = short(w11);
+        w_r1[2 * o + 1] = short(wy1 - w11);
+        w_r2[2 * o] = short(w21);
+        w_r2[2 * o + 1] = short(wy2 - w21);
+    }
+
+    for (size_t j = 0; j < col_spans.size(); ++j)
+    {
+        const InterpolationSpan &xs = col_spans[j];
+        const uchar *lkt11 = lkts1 + xs.cell1 * 256;
+        const uchar *lkt12 = lkts1 + xs.cell2 * 256;
+        const uchar *lkt21 = lkts2 + xs.cell1 * 256;
+        const uchar *lkt22 = lkts2 + xs.cell2 * 256;
+        const int n = xs.end - xs.begin;
+        const uchar *in_span = in_row + xs.begin;
+        uchar *out_span = out_row + xs.begin;
+        if (ys.inner && xs.inner)
+            fixed_interpolate_quads(in_span, out_span, n, &w_r1[0], &w_r2[0],
+                                    lkt11, lkt12, lkt21, lkt22);
+        else if (ys.inner)
+            fixed_interpolate_pairs(in_span, out_span, n, &w_c[0], lkt11, lkt21);
+        else if (xs.inner)
+            fixed_interpolate_pairs(in_span, out_span, n, &w_x[0], lkt11, lkt12);
+        else
+            interpolate_corner(in_span, out_span, n, lkt11);
+    }
+}
+
+/**
+ * @brief Apply the cell transforms interpolating them on the cell grid.
+ *
+ * The image is walked one interpolation block at a time. A block is the
+ * rectangle between four cell centers (or less in the borders), so the
+ * neighbouring transforms and the weight ramps are computed once per block
+ * instead of once per pixel.
+ *
+ * @param in is the input image extended to be a multiple of the cell size.
+ * @param lkts are the cell transforms, one row of 256 values per cell in row
+ *        major order.
+ * @param cell_size is the cell size. Both dimensions must be odd.
+ * @param grid_size is the number of cells.
+ * @param out is the output image. Its size sets the processed area.
+ * @param fixed_point use fixed point weights instead of float ones.
+ */
+static void interpolate_tiles(const cv::Mat &in, const cv::Mat &lkts,
+                              const cv::Size &cell_size, const cv::Size &grid_size,
+                              cv::Mat &out, bool fixed_point = false)
+{
+    CV_Assert(lkts.isContinuous());
+    const std::vector<InterpolationSpan> row_spans =
+        compute_interpolation_spans(out.rows, in.rows, cell_size.height);
+    const std::vector<InterpolationSpan> col_spans =
+        compute_interpolation_spans(out.cols, in.cols, cell_size.width);
+    std::vector<float> w_y, w_y2, w_x, w_x2;
+    compute_interpolation_weights(row_spans, cell_size.height, w_y, w_y2);
+    compute_interpolation_weights(col_spans, cell_size.width, w_x, w_x2);
+
+    for (size_t i = 0; i < row_spans.size(); ++i)
+    {
+        const InterpolationSpan &ys = row_spans[i];
+        const uchar *lkts1 = lkts.ptr<uchar>(ys.cell1 * grid_size.width);
+        const uchar *lkts2 = lkts.ptr<uchar>(ys.cell2 * grid_size.width);
+        for (int y = ys.begin; y < ys.end; ++y)
+        {
+            if (fixed_point)
+                fixed_interpolate_row(in.ptr<uchar>(y), out.ptr<uchar>(y), ys, w_y[y],
+                                      lkts1, lkts2, col_spans, cell_size.width);
+            else
+                interpolate_row(in.ptr<uchar>(y), out.ptr<uchar>(y), ys, w_y[y], w_y2[y],
+                                lkts1, lkts2, col_spans, w_x, w_x2);
+        }
+    }
 }
 
 cv::Mat
-fsiv_clahe(const cv::Mat &in_, float s, int radius)
+fsiv_clahe(const cv::Mat &in_, float s, int radius, bool fixed_point)
 {
     CV_Assert(in_.type() == CV_8UC1);
     cv::Mat out = in_.clone();
@@ -152,7 +541,7 @@ fsiv_clahe(const cv::Mat &in_, float s, int radius)
         // TODO: do a global equalization.
         // Hint: use fsiv_apply_lookup_table to apply the transform function
         // computed to all the image positions.
-        cv::Mat hist = fsiv_compute_image_histogram(in_);
+        cv::Mat hist = fsiv_compute_histogram_u8(in_);
         cv::Mat lkt =
             fsiv_create_equalization_lookup_table(hist, s);
         fsiv_apply_lookup_table(in_, lkt, out);
@@ -169,34 +558,422 @@ fsiv_clahe(const cv::Mat &in_, float s, int radius)
         // First extend the input if it is needed to be a multiple of the cell size.
         cv::Size cell_size = cv::Size(2 * radius + 1, 2 * radius + 1);
         // cv::Size cell_size = cv::Size(1 << radius, 1 << radius);
-        cv::Mat in = in_;
-        if ((in_.rows % cell_size.height) != 0 || (in_.cols % cell_size.width) != 0)
-        {
-            in = cv::Mat(in_.rows + cell_size.height - (in_.rows % cell_size.height),
-                         in_.cols + cell_size.width - (in_.cols % cell_size.width), in.type());
-            cv::copyMakeBorder(in_, in, 0, cell_size.height - (in_.rows % cell_size.height),
-                               0, cell_size.width - (in_.cols % cell_size.width), cv::BORDER_REFLECT101);
-        }
+        cv::Mat in = extend_to_cell_multiple(in_, cell_size);
         cv::Size grid_size = cv::Size(in.cols / cell_size.width, in.rows / cell_size.height);
         // Compute a transform function for each image cell.
-        std::vector<cv::Mat> lkts(grid_size.area());
-        for (int cell_row = 0; cell_row < grid_size.height; ++cell_row)
-            for (int cell_col = 0; cell_col < grid_size.width; ++cell_col)
+        cv::Mat lkts = compute_tile_lookup_tables(in, s, cell_size, grid_size);
+        // Apply the transform interpolating on the grid.
+        interpolate_tiles(in, lkts, cell_size, grid_size, out, fixed_point);
+        //
+    }
+    CV_Assert(out.size() == in_.size());
+    CV_Assert(out.type() == in_.type());
+    return out;
+}
+
+/**
+ * @brief Compute the equalized value of a gray level from its window histogram.
+ *
+ * The histogram is clipped as fsiv_create_equalization_lookup_table does, but
+ * only the accumulated value of the gray level to transform is computed.
+ *
+ * @param counts is the window histogram.
+ * @param area is the number of pixels in the window.
+ * @param v is the gray level to transform.
+ * @param s is the slope factor. A value < 1.0 means no contrast limitation.
+ * @param hist is a CV_32FC1 256x1 work buffer used to clip the histogram.
+ * @return the equalized value.
+ */
+static uchar equalize_window_value(const int *counts, int area, uchar v,
+                                   float s, cv::Mat &hist)
+{
+    float acc = 0.0f;
+    float total = area;
+    if (s >= 1.0)
+    {
+        float *h = hist.ptr<float>();
+        for (int i = 0; i < 256; ++i)
+            h[i] = counts[i];
+        const float cl = fsiv_compute_actual_clipping_histogram_value(hist, s);
+        fsiv_compute_clipped_histogram(hist, cl);
+        for (int i = 0; i <= v; ++i)
+            acc += h[i];
+        total = acc;
+        for (int i = v + 1; i < 256; ++i)
+            total += h[i];
+    }
+    else
+    {
+        int acc_i = 0;
+        for (int i = 0; i <= v; ++i)
+            acc_i += counts[i];
+        acc = acc_i;
+    }
+    return cv::saturate_cast<uchar>(255.0f * acc / total);
+}
+
+cv::Mat
+fsiv_clahe_sliding_window(const cv::Mat &in_, float s, int radius)
+{
+    CV_Assert(in_.type() == CV_8UC1);
+    CV_Assert(radius > 0);
+    cv::Mat out(in_.size(), in_.type());
+    cv::Mat in;
+    cv::copyMakeBorder(in_, in, radius, radius, radius, radius, cv::BORDER_REFLECT101);
+    const int win_size = 2 * radius + 1;
+    const int area = win_size * win_size;
+
+    // Each stripe of rows keeps its own column histograms, so the stripes can
+    // be processed in parallel.
+    cv::parallel_for_(cv::Range(0, in_.rows), [&](const cv::Range &range)
+    {
+        // Histogram of each (padded) column restricted to the window rows.
+        std::vector<ushort> col_hists(in.cols * 256, 0);
+        int win_hist[256];
+        cv::Mat hist(256, 1, CV_32FC1);
+        for (int y = range.start; y < range.end; ++y)
+        {
+            // The window of output row y covers the padded rows [y, y+win_size).
+            if (y == range.start)
             {
-                const int idx = cell_row * grid_size.width + cell_col;
-                cv::Mat hist = fsiv_compute_image_histogram(in(cv::Rect(cell_col * cell_size.width,
-                                                                        cell_row * cell_size.height, cell_size.width, cell_size.height)));
-                lkts[idx] = fsiv_create_equalization_lookup_table(hist, s);
+                for (int row = y; row < y + win_size; ++row)
+                {
+                    const uchar *p = in.ptr<uchar>(row);
+                    for (int x = 0; x < in.cols; ++x)
+                        ++col_hists[x * 256 + p[x]];
+                }
             }
-        // Apply the transform interpolating on the grid.
-        for (int y = 0; y < in_.rows; ++y)
+            else
+            {
+                const uchar *p_out = in.ptr<uchar>(y - 1);
+                const uchar *p_in = in.ptr<uchar>(y + win_size - 1);
+                for (int x = 0; x < in.cols; ++x)
+                {
+                    --col_hists[x * 256 + p_out[x]];
+                    ++col_hists[x * 256 + p_in[x]];
+                }
+            }
+
+            std::fill(win_hist, win_hist + 256, 0);
+            for (int x = 0; x < win_size; ++x)
+            {
+                const ushort *h = &col_hists[x * 256];
+                for (int i = 0; i < 256; ++i)
+                    win_hist[i] += h[i];
+            }
+
+            const uchar *in_row = in.ptr<uchar>(y + radius) + radius;
+            uchar *out_row = out.ptr<uchar>(y);
             for (int x = 0; x < in_.cols; ++x)
             {
-                out.at<uchar>(y, x) = compute_interpolate_value(in, lkts, cv::Point(x, y), cell_size, grid_size);
+                if (x > 0)
+                {
+                    // Slide the window one column: constant cost whatever the radius.
+                    const ushort *h_out = &col_hists[(x - 1) * 256];
+                    const ushort *h_in = &col_hists[(x + win_size - 1) * 256];
+                    for (int i = 0; i < 256; ++i)
+                        win_hist[i] += h_in[i] - h_out[i];
+                }
+                out_row[x] = equalize_window_value(win_hist, area, in_row[x], s, hist);
             }
-        //
-    }
+        }
+    }, cv::getNumThreads());
+
     CV_Assert(out.size() == in_.size());
     CV_Assert(out.type() == in_.type());
     return out;
 }
+
+ClaheVideoEqualizer::ClaheVideoEqualizer(float s, int radius, float change_th,
+                                         float alpha)
+    : s_(s), radius_(radius), change_th_(change_th), alpha_(alpha),
+      cell_size_(2 * radius + 1, 2 * radius + 1), updated_cells_(0)
+{
+    CV_Assert(radius > 0);
+    CV_Assert(change_th >= 0.0f);
+    CV_Assert(0.0f < alpha && alpha <= 1.0f);
+}
+
+void ClaheVideoEqualizer::reset()
+{
+    frame_size_ = cv::Size();
+    updated_cells_ = 0;
+}
+
+void ClaheVideoEqualizer::set_slope_factor(float s)
+{
+    s_ = s;
+    if (frame_size_.empty())
+        return;
+    cv::parallel_for_(cv::Range(0, grid_size_.area()), [&](const cv::Range &range)
+    {
+        for (int idx = range.start; idx < range.end; ++idx)
+            update_target_lookup_table(idx);
+    });
+}
+
+int ClaheVideoEqualizer::get_updated_cells() const
+{
+    return updated_cells_;
+}
+
+cv::Size ClaheVideoEqualizer::get_grid_size() const
+{
+    return grid_size_;
+}
+
+void ClaheVideoEqualizer::update_target_lookup_table(int idx)
+{
+    const cv::Mat lkt = fsiv_create_equalization_lookup_table(hists_.row(idx).reshape(1, 256), s_);
+    const uchar *src = lkt.ptr<uchar>();
+    float *dst = targets_.ptr<float>(idx);
+    for (int v = 0; v < 256; ++v)
+        dst[v] = src[v];
+}
+
+cv::Mat ClaheVideoEqualizer::process(const cv::Mat &frame)
+{
+    CV_Assert(frame.type() == CV_8UC1);
+    const bool first_frame = frame.size() != frame_size_;
+    const cv::Mat in = extend_to_cell_multiple(frame, cell_size_);
+    if (first_frame)
+    {
+        frame_size_ = frame.size();
+        grid_size_ = cv::Size(in.cols / cell_size_.width, in.rows / cell_size_.height);
+        ref_frame_.create(in.size(), CV_8UC1);
+        hists_.create(grid_size_.area(), 256, CV_32FC1);
+        targets_.create(grid_size_.area(), 256, CV_32FC1);
+        smoothed_.create(grid_size_.area(), 256, CV_32FC1);
+        lkts_.create(grid_size_.area(), 256, CV_8UC1);
+    }
+
+    std::atomic<int> updated_cells(0);
+    cv::parallel_for_(cv::Range(0, grid_size_.area()), [&](const cv::Range &range)
+    {
+        for (int idx = range.start; idx < range.end; ++idx)
+        {
+            const cv::Rect cell = cell_rect(idx, cell_size_, grid_size_);
+            const cv::Mat in_cell = in(cell);
+            cv::Mat ref_cell = ref_frame_(cell);
+            if (first_frame ||
+                cv::norm(in_cell, ref_cell, cv::NORM_L1) > change_th_ * cell.area())
+            {
+                const cv::Mat hist = fsiv_compute_histogram_u8(in_cell);
+                hist.reshape(1, 1).copyTo(hists_.row(idx));
+                update_target_lookup_table(idx);
+                in_cell.copyTo(ref_cell);
+                ++updated_cells;
+            }
+
+            const float *target = targets_.ptr<float>(idx);
+            float *smoothed = smoothed_.ptr<float>(idx);
+            uchar *lkt = lkts_.ptr<uchar>(idx);
+            for (int v = 0; v < 256; ++v)
+            {
+                if (first_frame)
+                    smoothed[v] = target[v];
+                else
+                    smoothed[v] += alpha_ * (target[v] - smoothed[v]);
+                lkt[v] = cv::saturate_cast<uchar>(smoothed[v]);
+            }
+        }
+    });
+    updated_cells_ = updated_cells;
+
+    cv::Mat out(frame.size(), frame.type());
+    interpolate_tiles(in, lkts_, cell_size_, grid_size_, out);
+    return out;
+}
+
+ClaheContext::ClaheContext()
+    : radius_(0)
+{
+}
+
+bool ClaheContext::empty() const
+{
+    return in_.empty();
+}
+
+int ClaheContext::get_radius() const
+{
+    return radius_;
+}
+
+void ClaheContext::set_image(const cv::Mat &in, int radius)
+{
+    CV_Assert(in.type() == CV_8UC1);
+    CV_Assert(radius >= 0);
+    size_ = in.size();
+    radius_ = radius;
+    if (radius == 0)
+    {
+        // Global equalization: only one cell covering the whole image.
+        cell_size_ = in.size();
+        in_ = in;
+    }
+    else
+    {
+        cell_size_ = cv::Size(2 * radius + 1, 2 * radius + 1);
+        in_ = extend_to_cell_multiple(in, cell_size_);
+    }
+    grid_size_ = cv::Size(in_.cols / cell_size_.width, in_.rows / cell_size_.height);
+    hists_.create(grid_size_.area(), 256, CV_32FC1);
+    lkts_.create(grid_size_.area(), 256, CV_8UC1);
+    cv::parallel_for_(cv::Range(0, grid_size_.area()), [&](const cv::Range &range)
+    {
+        for (int idx = range.start; idx < range.end; ++idx)
+        {
+            const cv::Mat hist = fsiv_compute_histogram_u8(in_(cell_rect(idx, cell_size_, grid_size_)));
+            hist.reshape(1, 1).copyTo(hists_.row(idx));
+        }
+    });
+}
+
+cv::Mat ClaheContext::apply(float s, bool fixed_point)
+{
+    CV_Assert(!empty());
+    cv::parallel_for_(cv::Range(0, grid_size_.area()), [&](const cv::Range &range)
+    {
+        for (int idx = range.start; idx < range.end; ++idx)
+        {
+            const cv::Mat lkt = fsiv_create_equalization_lookup_table(hists_.row(idx).reshape(1, 256), s);
+            lkt.reshape(1, 1).copyTo(lkts_.row(idx));
+        }
+    });
+
+    cv::Mat out;
+    if (radius_ == 0)
+    {
+        in_.copyTo(out);
+        fsiv_apply_lookup_tables(out, std::vector<cv::Mat>(1, lkts_.row(0)));
+    }
+    else
+    {
+        out.create(size_, CV_8UC1);
+        interpolate_tiles(in_, lkts_, cell_size_, grid_size_, out, fixed_point);
+    }
+    return out;
+}
+
+ClaheStripEqualizer::ClaheStripEqualizer(const cv::Size &image_size, float s, int radius)
+    : image_size_(image_size), s_(s), in_rows_(0), out_rows_(0), next_span_(0)
+{
+    CV_Assert(radius > 0);
+    CV_Assert(image_size.width > 0 && image_size.height > 0);
+    cell_size_ = cv::Size(2 * radius + 1, 2 * radius + 1);
+    // Same padding than extend_to_cell_multiple().
+    padded_size_ = image_size;
+    if ((image_size.height % cell_size_.height) != 0 || (image_size.width % cell_size_.width) != 0)
+        padded_size_ = cv::Size(image_size.width + cell_size_.width - (image_size.width % cell_size_.width),
+                                image_size.height + cell_size_.height - (image_size.height % cell_size_.height));
+    grid_size_ = cv::Size(padded_size_.width / cell_size_.width,
+                          padded_size_.height / cell_size_.height);
+    rows_.create(3 * cell_size_.height, padded_size_.width, CV_8UC1);
+    lkts_.create(2, grid_size_.width * 256, CV_8UC1);
+    compute_interpolation_weights(compute_interpolation_spans(image_size_.width, padded_size_.width,
+                                                              cell_size_.width),
+                                  cell_size_.width, w_x_, w_x2_);
+}
+
+int ClaheStripEqualizer::get_output_rows() const
+{
+    return out_rows_;
+}
+
+bool ClaheStripEqualizer::done() const
+{
+    return out_rows_ == image_size_.height;
+}
+
+const uchar *ClaheStripEqualizer::padded_row(int y) const
+{
+    CV_Assert(in_rows_ - rows_.rows <= y && y < in_rows_);
+    return rows_.ptr<uchar>(y % rows_.rows);
+}
+
+void ClaheStripEqualizer::add_row(const uchar *row)
+{
+    uchar *dst = rows_.ptr<uchar>(in_rows_ % rows_.rows);
+    std::copy(row, row + image_size_.width, dst);
+    for (int x = image_size_.width; x < padded_size_.width; ++x)
+        dst[x] = row[cv::borderInterpolate(x, image_size_.width, cv::BORDER_REFLECT101)];
+    ++in_rows_;
+}
+
+void ClaheStripEqualizer::compute_cell_row_lookup_tables(int cy)
+{
+    const int y0 = (cy % 3) * cell_size_.height;
+    uchar *lkts = lkts_.ptr<uchar>(cy % 2);
+    cv::parallel_for_(cv::Range(0, grid_size_.width), [&](const cv::Range &range)
+    {
+        for (int cx = range.start; cx < range.end; ++cx)
+        {
+            const cv::Rect cell(cx * cell_size_.width, y0, cell_size_.width, cell_size_.height);
+            const cv::Mat hist = fsiv_compute_histogram_u8(rows_(cell));
+            const cv::Mat lkt = fsiv_create_equalization_lookup_table(hist, s_);
+            std::copy(lkt.ptr<uchar>(), lkt.ptr<uchar>() + 256, lkts + cx * 256);
+        }
+    });
+}
+
+cv::Mat ClaheStripEqualizer::push(const cv::Mat &strip)
+{
+    CV_Assert(strip.type() == CV_8UC1 && strip.cols == image_size_.width);
+    CV_Assert(in_rows_ + strip.rows <= image_size_.height);
+
+    const int c = cell_size_.height;
+    const int off = c >> 1;
+    const std::vector<InterpolationSpan> row_spans =
+        compute_interpolation_spans(image_size_.height, padded_size_.height, c);
+    const std::vector<InterpolationSpan> col_spans =
+        compute_interpolation_spans(image_size_.width, padded_size_.width, cell_size_.width);
+
+    // A row span can be returned when its second row of cells is complete.
+    const int last = in_rows_ + strip.rows;
+    const int completed = (last == image_size_.height ? padded_size_.height : last) / c;
+    int n_out = 0;
+    for (size_t i = next_span_; i < row_spans.size() && row_spans[i].cell2 < completed; ++i)
+        n_out += row_spans[i].end - row_spans[i].begin;
+    cv::Mat out(n_out, image_size_.width, CV_8UC1);
+    const int first_out = out_rows_;
+
+    // Add a row and, when it completes a row of cells, return the row spans
+    // that depend on it.
+    auto add = [&](const uchar *row)
+    {
+        add_row(row);
+        if (in_rows_ % c != 0)
+            return;
+        const int cy = in_rows_ / c - 1;
+        compute_cell_row_lookup_tables(cy);
+        for (; next_span_ < int(row_spans.size()) && row_spans[next_span_].cell2 <= cy; ++next_span_)
+        {
+            const InterpolationSpan &ys = row_spans[next_span_];
+            const uchar *lkts1 = lkts_.ptr<uchar>(ys.cell1 % 2);
+            const uchar *lkts2 = lkts_.ptr<uchar>(ys.cell2 % 2);
+            const float center2 = ys.cell2 * c + off;
+            cv::parallel_for_(cv::Range(ys.begin, ys.end), [&](const cv::Range &range)
+            {
+                for (int y = range.start; y < range.end; ++y)
+                {
+                    const float w_y = ys.inner ? (center2 - y) / c : 0.0f;
+                    const float w_y2 = ys.inner ? 1.0f - w_y : 0.0f;
+                    interpolate_row(padded_row(y), out.ptr<uchar>(y - first_out), ys,
+                                    w_y, w_y2, lkts1, lkts2, col_spans, w_x_, w_x2_);
+                }
+            });
+            out_rows_ = ys.end;
+        }
+    };
+
+    for (int y = 0; y < strip.rows; ++y)
+        add(strip.ptr<uchar>(y));
+    // The image bottom is extended reflecting the last rows.
+    if (in_rows_ == image_size_.height)
+        while (in_rows_ < padded_size_.height)
+            add(padded_row(cv::borderInterpolate(in_rows_, image_size_.height,
+                                                 cv::BORDER_REFLECT101)));
+    CV_Assert(out_rows_ - first_out == out.rows);
+    return out;
+}
@@ -9,6 +9,7 @@
  *
  */
 #pragma once
+#include <vector>
 #include <opencv2/core.hpp>
 
 /**
@@ -16,6 +17,230 @@
  * @param in is the input image.
  * @param s is a factor that controls the contrast limitation. If \arg s < 1, do not apply such control.
  * @param r set the windows radius to do a local image equalization. If \arg r=0, a global equalization will be done.
+ * @param fixed_point interpolate the cell transforms with 16 bits fixed point
+ *        weights instead of float ones. The result can differ in one gray level.
  * @return The output image.
  */
-cv::Mat fsiv_clahe(const cv::Mat &in, float s, int radius);
\ No newline at end of file
+cv::Mat fsiv_clahe(const cv::Mat &in, float s, int radius, bool fixed_point = false);
+
+/**
+ * @brief Do a contrast limited adaptive histogram equalization using a sliding window.
+ *
+ * Each pixel is equalized with the histogram of the (2r+1)x(2r+1) window
+ * centered on it, so there are no interpolation artefacts between cells. The
+ * window histogram is updated column by column (Perreault and Hébert method)
+ * so the cost per pixel does not depend on the radius.
+ *
+ * @param in is the input image.
+ * @param s is a factor that controls the contrast limitation. If \arg s < 1, do not apply such control.
+ * @param radius is the window radius.
+ * @return The output image.
+ * @pre in.type()==CV_8UC1
+ * @pre radius>0
+ */
+cv::Mat fsiv_clahe_sliding_window(const cv::Mat &in, float s, int radius);
+
+/**
+ * @brief Contrast limited adaptive histogram equalization of a video stream.
+ *
+ * It does the same processing as fsiv_clahe() but the cell histograms are
+ * kept between frames. A cell histogram is only recomputed when the mean
+ * absolute difference between the cell and the frame used to compute its
+ * histogram is greater than a threshold, so static areas are not processed
+ * again. The cell transforms are smoothed over time with an exponential
+ * moving average to avoid flickering.
+ */
+class ClaheVideoEqualizer
+{
+public:
+    /**
+     * @brief Create the equalizer.
+     * @param s is a factor that controls the contrast limitation. If \arg s < 1, do not apply such control.
+     * @param radius set the cell radius. The cell size is (2r+1)x(2r+1).
+     * @param change_th is the mean absolute difference needed to recompute a cell histogram.
+     * @param alpha is the temporal smoothing factor of the cell transforms. A value 1 means no smoothing.
+     * @pre radius>0
+     * @pre change_th>=0.0
+     * @pre 0.0<alpha && alpha<=1.0
+     */
+    ClaheVideoEqualizer(float s, int radius, float change_th = 2.0f,
+                        float alpha = 0.25f);
+
+    /**
+     * @brief Equalize the next frame of the stream.
+     * @param frame is the input frame.
+     * @return the equalized frame.
+     * @pre frame.type()==CV_8UC1
+     * @post ret_v.size()==frame.size() && ret_v.type()==frame.type()
+     * @warning A change of the frame size restarts the stream.
+     */
+    cv::Mat process(const cv::Mat &frame);
+
+    /**
+     * @brief Forget the previous frames.
+     * The next frame will compute all its cell histograms.
+     */
+    void reset();
+
+    /**
+     * @brief Change the slope factor.
+     * The cell transforms are rebuilt from the kept histograms.
+     * @param s is the new slope factor.
+     */
+    void set_slope_factor(float s);
+
+    /**
+     * @brief Get the number of cell histograms recomputed with the last frame.
+     */
+    int get_updated_cells() const;
+
+    /**
+     * @brief Get the number of cells of the grid.
+     */
+    cv::Size get_grid_size() const;
+
+protected:
+    void update_target_lookup_table(int idx);
+
+    float s_;
+    int radius_;
+    float change_th_;
+    float alpha_;
+    cv::Size cell_size_;
+    cv::Size grid_size_;
+    cv::Size frame_size_;
+    cv::Mat ref_frame_;  // frame used to compute each cell histogram.
+    cv::Mat hists_;      // cell histograms, a row per cell (CV_32FC1).
+    cv::Mat targets_;    // cell transforms of the kept histograms (CV_32FC1).
+    cv::Mat smoothed_;   // temporally smoothed cell transforms (CV_32FC1).
+    cv::Mat lkts_;       // cell transforms used to interpolate (CV_8UC1).
+    int updated_cells_;
+};
+
+/**
+ * @brief Keep the cell histograms of an image to equalize it with several slope factors.
+ *
+ * The cell histograms only depend on the image and the radius, so they are
+ * computed once by set_image(). Then apply() only rebuilds the clipped cell
+ * transforms and interpolates them, which is what an interactive change of
+ * the slope factor needs.
+ */
+class ClaheContext
+{
+public:
+    /**
+     * @brief Create an empty context.
+     */
+    ClaheContext();
+
+    /**
+     * @brief Set the image to equalize and compute its cell histograms.
+     * @param in is the input image.
+     * @param radius set the cell radius. If \arg r=0, a global equalization will be done.
+     * @pre in.type()==CV_8UC1
+     * @pre radius>=0
+     */
+    void set_image(const cv::Mat &in, int radius);
+
+    /**
+     * @brief Equalize the image with a slope factor.
+     * @param s is a factor that controls the contrast limitation. If \arg s < 1, do not apply such control.
+     * @param fixed_point interpolate the cell transforms with fixed point weights.
+     * @return the same image than fsiv_clahe(in, s, radius, fixed_point).
+     * @pre !empty()
+     */
+    cv::Mat apply(float s, bool fixed_point = false);
+
+    /**
+     * @brief Check if an image was set.
+     */
+    bool empty() const;
+
+    /**
+     * @brief Get the radius used to compute the cell histograms.
+     */
+    int get_radius() const;
+
+protected:
+    cv::Size size_;      // input image size.
+    int radius_;
+    cv::Size cell_size_;
+    cv::Size grid_size_;
+    cv::Mat in_;         // input image extended to a multiple of the cell size.
+    cv::Mat hists_;      // cell histograms, a row per cell (CV_32FC1).
+    cv::Mat lkts_;       // cell transforms, a row per cell (CV_8UC1).
+};
+
+/**
+ * @brief Equalize an image with CLAHE reading and writing it in horizontal strips.
+ *
+ * The input rows are pushed in strips of any height and the output rows are
+ * returned as soon as their neighbouring cell transforms are known. Only the
+ * last three rows of cells and the transforms of two rows of cells are kept,
+ * so the memory used does not depend on the image height. The output is the
+ * same than fsiv_clahe(in, s, radius).
+ */
+class ClaheStripEqualizer
+{
+public:
+    /**
+     * @brief Create the equalizer.
+     * @param image_size is the size of the whole image.
+     * @param s is a factor that controls the contrast limitation. If \arg s < 1, do not apply such control.
+     * @param radius set the cell radius.
+     * @pre radius>0
+     * @pre image_size.width>0 && image_size.height>0
+     */
+    ClaheStripEqualizer(const cv::Size &image_size, float s, int radius);
+
+    /**
+     * @brief Push the next input rows.
+     * @param strip are the next rows of the input image.
+     * @return the next output rows ready. It can be empty.
+     * @pre strip.type()==CV_8UC1 && strip.cols==image_size.width
+     * @pre the total pushed rows are not more than image_size.height.
+     */
+    cv::Mat push(const cv::Mat &strip);
+
+    /**
+     * @brief Get the number of output rows returned.
+     */
+    int get_output_rows() const;
+
+    /**
+     * @brief Check if all the output rows were returned.
+     */
+    bool done() const;
+
+protected:
+    /**
+     * @brief Append a row extended to the padded width to the cell rows.
+     * @param row is the input row.
+     */
+    void add_row(const uchar *row);
+
+    /**
+     * @brief Compute the transforms of the last completed row of cells.
+     * @param cy is the row of cells.
+     */
+    void compute_cell_row_lookup_tables(int cy);
+
+    /**
+     * @brief Get the row of the buffered padded image.
+     * @param y is the padded image row. It must be buffered.
+     */
+    const uchar *padded_row(int y) const;
+
+    cv::Size image_size_;
+    cv::Size padded_size_;
+    cv::Size cell_size_;
+    cv::Size grid_size_;
+    float s_;
+    cv::Mat rows_;      // ring with the last three rows of cells (padded).
+    cv::Mat lkts_;      // ring with the transforms of the last two rows of cells.
+    int in_rows_;       // number of padded rows added.
+    int out_rows_;      // number of output rows returned.
+    int next_span_;     // next row interpolation span to be returned.
+    std::vector<float> w_x_;  // column weights of the first cell column.
+    std::vector<float> w_x2_; // column weights of the second cell column.
+};
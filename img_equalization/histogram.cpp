@@ -0,0 +1,106 @@
+/**
+ * @file histogram.cpp
+ * @brief High throughput gray level histogram.
+ * @version 1.0
+ * @date 2024-09-13
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include "histogram.hpp"
+#include <algorithm>
+#include <vector>
+#include <opencv2/core/utility.hpp>
+
+// Images with less pixels are processed in a single thread.
+static const size_t PARALLEL_MIN_PIXELS = 1 << 16;
+
+/**
+ * @brief Count the gray levels of a row range.
+ * @param in is the input image.
+ * @param mask is the mask or an empty Mat.
+ * @param rows is the range of rows to count.
+ * @param counts are the 256 counters to be incremented.
+ */
+static void accumulate_rows(const cv::Mat &in, const cv::Mat &mask,
+                            const cv::Range &rows, unsigned int counts[256])
+{
+    unsigned int h[4][256] = {};
+    const int cols = in.cols;
+    for (int y = rows.start; y < rows.end; ++y)
+    {
+        const uchar *p = in.ptr<uchar>(y);
+        int x = 0;
+        if (mask.empty())
+        {
+            for (; x <= cols - 4; x += 4)
+            {
+                ++h[0][p[x]];
+                ++h[1][p[x + 1]];
+                ++h[2][p[x + 2]];
+                ++h[3][p[x + 3]];
+            }
+            for (; x < cols; ++x)
+                ++h[0][p[x]];
+        }
+        else
+        {
+            // Add the mask test result to avoid a branch per pixel.
+            const uchar *m = mask.ptr<uchar>(y);
+            for (; x <= cols - 4; x += 4)
+            {
+                h[0][p[x]] += m[x] != 0;
+                h[1][p[x + 1]] += m[x + 1] != 0;
+                h[2][p[x + 2]] += m[x + 2] != 0;
+                h[3][p[x + 3]] += m[x + 3] != 0;
+            }
+            for (; x < cols; ++x)
+                h[0][p[x]] += m[x] != 0;
+        }
+    }
+    for (int v = 0; v < 256; ++v)
+        counts[v] += h[0][v] + h[1][v] + h[2][v] + h[3][v];
+}
+
+void fsiv_accumulate_histogram_u8(const cv::Mat &in, const cv::Mat &mask,
+                                  unsigned int counts[256])
+{
+    CV_Assert(in.type() == CV_8UC1);
+    CV_Assert(mask.empty() || (mask.type() == CV_8UC1 && mask.size() == in.size()));
+    accumulate_rows(in, mask, cv::Range(0, in.rows), counts);
+}
+
+cv::Mat fsiv_compute_histogram_u8(const cv::Mat &in, const cv::Mat &mask)
+{
+    CV_Assert(in.type() == CV_8UC1);
+    CV_Assert(mask.empty() || (mask.type() == CV_8UC1 && mask.size() == in.size()));
+
+    unsigned int counts[256] = {};
+    if (in.total() < PARALLEL_MIN_PIXELS || cv::getNumThreads() <= 1)
+        accumulate_rows(in, mask, cv::Range(0, in.rows), counts);
+    else
+    {
+        // A partial histogram per stripe, so the threads do not share counters.
+        const int nstripes = std::min(cv::getNumThreads(), in.rows);
+        std::vector<unsigned int> partials(nstripes * 256, 0);
+        cv::parallel_for_(cv::Range(0, nstripes), [&](const cv::Range &range)
+        {
+            for (int i = range.start; i < range.end; ++i)
+            {
+                const cv::Range rows(i * in.rows / nstripes, (i + 1) * in.rows / nstripes);
+                accumulate_rows(in, mask, rows, &partials[i * 256]);
+            }
+        });
+        for (int i = 0; i < nstripes; ++i)
+            for (int v = 0; v < 256; ++v)
+                counts[v] += partials[i * 256 + v];
+    }
+
+    cv::Mat hist(256, 1, CV_32FC1);
+    for (int v = 0; v < 256; ++v)
+        hist.at<float>(v) = float(counts[v]);
+
+    CV_Assert(hist.type() == CV_32FC1);
+    CV_Assert(hist.rows == 256 && hist.cols == 1);
+    return hist;
+}
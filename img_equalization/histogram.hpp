@@ -0,0 +1,43 @@
+/**
+ * @file histogram.hpp
+ * @brief High throughput gray level histogram.
+ * @version 1.0
+ * @date 2024-09-13
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#pragma once
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Accumulate the gray level counts of an image in a single thread.
+ *
+ * The counts are spread over four private sub-histograms that are added at
+ * the end, so consecutive pixels with the same gray level do not wait for
+ * the previous increment of the same counter.
+ *
+ * @param in is the input image. Use a ROI to count only an image area.
+ * @param mask if it is not empty, only the pixels with mask!=0 are counted.
+ * @param counts are the 256 counters to be incremented.
+ * @pre in.type()==CV_8UC1
+ * @pre mask.empty() || (mask.type()==CV_8UC1 && mask.size()==in.size())
+ */
+void fsiv_accumulate_histogram_u8(const cv::Mat &in, const cv::Mat &mask,
+                                  unsigned int counts[256]);
+
+/**
+ * @brief Compute the histogram of an image.
+ *
+ * Large images are split in row stripes processed in parallel, each one with
+ * its own partial histogram. The partial histograms are merged at the end.
+ * The result is the same that cv::calcHist() with 256 bins in [0, 256).
+ *
+ * @param in is the input image. Use a ROI to count only an image area.
+ * @param mask if it is not empty, only the pixels with mask!=0 are counted.
+ * @return the histogram (not normalized).
+ * @pre in.type()==CV_8UC1
+ * @pre mask.empty() || (mask.type()==CV_8UC1 && mask.size()==in.size())
+ * @post ret.type()==CV_32FC1 && ret.rows==256 && ret.cols==1
+ */
+cv::Mat fsiv_compute_histogram_u8(const cv::Mat &in, const cv::Mat &mask = cv::Mat());
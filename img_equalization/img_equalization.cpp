@@ -1,5 +1,13 @@
 #include <iostream>
 #include <exception>
+#include <fstream>
+#include <limits>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 #include <opencv2/core/core.hpp>
 #include <opencv2/core/utility.hpp>
@@ -13,6 +21,14 @@ const cv::String keys =
     "{i interactive  |      | Activate interactive mode.}"
     "{r radius       |5     | Set the roi size to (2*2^r+1). A value r=0 means global processing.}"
     "{s slope_factor |3.0   | Set the slope factor to control the contrast limitation. A value <1.0 do not do such control.}"
+    "{x fixed_point  |      | Interpolate the cell transforms with fixed point arithmetic.}"
+    "{w sliding      |      | Equalize each pixel with a sliding window centered on it instead of interpolating the cell transforms.}"
+    "{v video        |      | The input and output are videos. The cell histograms are reused between frames.}"
+    "{t change_th    |2.0   | Video mode: mean absolute difference of a cell needed to recompute its histogram.}"
+    "{a alpha        |0.25  | Video mode: temporal smoothing factor of the cell transforms. A value 1.0 means no smoothing.}"
+    "{b batch        |      | The input and output are directories. The images are read, equalized and written in a pipeline.}"
+    "{q queue_size   |4     | Batch mode: maximum number of images waiting between two stages.}"
+    "{g strip        |0     | Process the image in strips of this number of rows keeping a bounded memory. The input and output must be binary PGM files.}"
     "{@input         |<none>| Input image.}"
     "{@output        |<none>| Output image.}";
 
@@ -20,39 +36,480 @@ typedef struct
 {
   cv::Mat in;
   cv::Mat out;
+  cv::Mat luma;                  // channel to equalize, computed once.
+  std::vector<cv::Mat> channels; // HSV channels of a BGR input.
+  ClaheContext ctx;              // cell histograms of the luma channel.
   bool interactive;
+  bool sliding;
+  bool fixed_point;
   int r;
   float s;
 } UserData;
 
-void do_the_work(UserData *data)
+/**
+ * @brief Get the channel to be equalized.
+ * @param in is the input image (gray or BGR).
+ * @param channels are set to the HSV channels of a BGR input.
+ * @return the gray image or the V channel of a BGR image.
+ */
+cv::Mat get_luma(const cv::Mat &in, std::vector<cv::Mat> &channels)
 {
-  cv::Mat in = data->in;
-  std::vector<cv::Mat> channels;
-  if (data->in.channels() == 3)
+  if (in.channels() == 3)
   {
     cv::Mat hsv;
-    cv::cvtColor(data->in, hsv, cv::COLOR_BGR2HSV);
+    cv::cvtColor(in, hsv, cv::COLOR_BGR2HSV);
     cv::split(hsv, channels);
-    in = channels[2];
+    return channels[2];
   }
+  return in;
+}
 
-  cv::Mat out = fsiv_clahe(in, data->s, data->r);
-
-  if (data->in.channels() == 3)
+/**
+ * @brief Build the output image from the equalized channel.
+ * @param luma is the equalized channel.
+ * @param channels are the HSV channels returned by get_luma().
+ * @return the output image.
+ */
+cv::Mat set_luma(const cv::Mat &luma, std::vector<cv::Mat> &channels)
+{
+  if (channels.size() == 3)
   {
-    cv::Mat hsv;
-    channels[2] = out;
+    cv::Mat hsv, out;
+    channels[2] = luma;
     cv::merge(channels, hsv);
-    cv::cvtColor(hsv, data->out, cv::COLOR_HSV2BGR);
+    cv::cvtColor(hsv, out, cv::COLOR_HSV2BGR);
+    return out;
+  }
+  return luma;
+}
+
+void do_the_work(UserData *data)
+{
+  if (data->luma.empty())
+    data->luma = get_luma(data->in, data->channels);
+
+  cv::Mat out;
+  if (data->sliding && data->r > 0)
+    out = fsiv_clahe_sliding_window(data->luma, data->s, data->r);
+  else if (data->interactive)
+  {
+    // Only a radius change needs to recompute the cell histograms.
+    if (data->ctx.empty() || data->ctx.get_radius() != data->r)
+      data->ctx.set_image(data->luma, data->r);
+    out = data->ctx.apply(data->s, data->fixed_point);
   }
   else
-    data->out = out;
+    out = fsiv_clahe(data->luma, data->s, data->r, data->fixed_point);
+
+  data->out = set_luma(out, data->channels);
 
   if (data->interactive)
     cv::imshow("OUTPUT", data->out);
 }
 
+/**
+ * @brief Equalize a video reusing the cell histograms between frames.
+ * @param input_name is the input video.
+ * @param output_name is the output video.
+ * @param s is the slope factor.
+ * @param radius set the cell radius to 2^radius.
+ * @param change_th is the mean absolute difference needed to recompute a cell.
+ * @param alpha is the temporal smoothing factor of the cell transforms.
+ * @param interactive show the frames while processing.
+ * @return the program exit code.
+ */
+int process_video(const cv::String &input_name, const cv::String &output_name,
+                  float s, int radius, float change_th, float alpha,
+                  bool interactive)
+{
+  cv::VideoCapture vid(input_name);
+  if (!vid.isOpened())
+  {
+    std::cerr << "Error: could not open the input video." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  cv::Mat frame;
+  vid >> frame;
+  if (frame.empty())
+  {
+    std::cerr << "Error: could not capture any frame from the input video." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  radius = std::max(0, std::min(radius, int(std::log(std::min(frame.rows, frame.cols)))));
+  if (radius == 0)
+  {
+    std::cerr << "Error: video mode needs a radius r>0." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  double fps = vid.get(cv::CAP_PROP_FPS);
+  if (fps <= 0.0)
+    fps = 25.0;
+  cv::VideoWriter writer;
+  if (!writer.open(output_name, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), fps,
+                   frame.size(), frame.channels() == 3))
+  {
+    std::cerr << "Error: could not create the output video '"
+              << output_name << "'." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  ClaheVideoEqualizer equalizer(s, 1 << radius, change_th, alpha);
+  cv::TickMeter timer;
+  int n_frames = 0;
+  double updated_cells = 0.0;
+  int key = 0;
+  while (!frame.empty() && key != 27)
+  {
+    timer.start();
+    std::vector<cv::Mat> channels;
+    cv::Mat out = set_luma(equalizer.process(get_luma(frame, channels)), channels);
+    timer.stop();
+    ++n_frames;
+    updated_cells += equalizer.get_updated_cells();
+
+    writer << out;
+    if (interactive)
+    {
+      cv::imshow("INPUT", frame);
+      cv::imshow("OUTPUT", out);
+      key = cv::waitKey(1) & 0xff;
+    }
+    vid >> frame;
+  }
+
+  std::cout << "Frames processed : " << n_frames << std::endl;
+  std::cout << "Throughput (fps) : " << n_frames / timer.getTimeSec() << std::endl;
+  std::cout << "Cells updated (%): "
+            << 100.0 * updated_cells / (double(n_frames) * equalizer.get_grid_size().area())
+            << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Read the header of a binary PGM (P5) file.
+ * @param in is the input stream.
+ * @param size is set to the image size.
+ * @return true if it is a 8 bits binary PGM file.
+ */
+bool read_pgm_header(std::istream &in, cv::Size &size)
+{
+  std::string magic;
+  int values[3] = {0, 0, 0};
+  in >> magic;
+  for (int i = 0; i < 3 && in; ++i)
+  {
+    // Skip the comments.
+    in >> std::ws;
+    while (in.peek() == '#')
+    {
+      in.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+      in >> std::ws;
+    }
+    in >> values[i];
+  }
+  // Only one whitespace is allowed after the max value.
+  in.get();
+  size = cv::Size(values[0], values[1]);
+  return in && magic == "P5" && size.area() > 0 && values[2] == 255;
+}
+
+/**
+ * @brief Equalize a binary PGM image in strips keeping a bounded memory.
+ * @param input_name is the input image.
+ * @param output_name is the output image.
+ * @param s is the slope factor.
+ * @param radius set the cell radius to 2^radius.
+ * @param strip_rows is the number of rows read each time.
+ * @return the program exit code.
+ */
+int process_strips(const cv::String &input_name, const cv::String &output_name,
+                   float s, int radius, int strip_rows)
+{
+  std::ifstream input(input_name.c_str(), std::ios::binary);
+  cv::Size size;
+  if (!input || !read_pgm_header(input, size))
+  {
+    std::cerr << "Error: could not open the input image as a binary PGM file." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  radius = std::max(0, std::min(radius, int(std::log(std::min(size.height, size.width)))));
+  if (radius == 0)
+  {
+    std::cerr << "Error: strip mode needs a radius r>0." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream output(output_name.c_str(), std::ios::binary);
+  if (!output)
+  {
+    std::cerr << "Error: could not create the output image '"
+              << output_name << "'." << std::endl;
+    return EXIT_FAILURE;
+  }
+  output << "P5\n" << size.width << " " << size.height << "\n255\n";
+
+  ClaheStripEqualizer equalizer(size, s, 1 << radius);
+  cv::Mat strip(strip_rows, size.width, CV_8UC1);
+  for (int y = 0; y < size.height; y += strip_rows)
+  {
+    const int rows = std::min(strip_rows, size.height - y);
+    cv::Mat in_strip = strip.rowRange(0, rows);
+    if (!input.read(reinterpret_cast<char *>(in_strip.data), std::streamsize(rows) * size.width))
+    {
+      std::cerr << "Error: the input image is truncated." << std::endl;
+      return EXIT_FAILURE;
+    }
+    const cv::Mat out_strip = equalizer.push(in_strip);
+    output.write(reinterpret_cast<const char *>(out_strip.data),
+                 std::streamsize(out_strip.rows) * size.width);
+  }
+  if (!output)
+  {
+    std::cerr << "Error: could not save the result in file '"
+              << output_name << "'." << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief A queue with a maximum size shared by two pipeline stages.
+ *
+ * push() waits while the queue is full and pop() waits while it is empty,
+ * so a fast stage can not get ahead of a slow one more than the queue size.
+ */
+template <class T>
+class BoundedQueue
+{
+public:
+  explicit BoundedQueue(size_t max_size) : max_size_(max_size), closed_(false),
+                                           aborted_(false) {}
+
+  /**
+   * @brief Add an item, waiting while the queue is full.
+   * @return false if the queue was aborted (the item is dropped).
+   */
+  bool push(const T &item)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return items_.size() < max_size_ || aborted_; });
+    if (aborted_)
+      return false;
+    items_.push_back(item);
+    not_empty_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Get the next item.
+   * @return false if the queue is empty and closed.
+   */
+  bool pop(T &item)
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return !items_.empty() || closed_ || aborted_; });
+    if (items_.empty() || aborted_)
+      return false;
+    item = items_.front();
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Signal that no more items will be pushed.
+   */
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+  }
+
+  /**
+   * @brief Wake up and stop the producers and the consumers.
+   */
+  void abort()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    aborted_ = true;
+    items_.clear();
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+protected:
+  size_t max_size_;
+  bool closed_;
+  bool aborted_;
+  std::deque<T> items_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+
+typedef struct
+{
+  cv::String name; // output file name.
+  cv::Mat img;
+} BatchItem;
+
+/**
+ * @brief Equalize all the images of a directory.
+ *
+ * The reading, the equalization and the writing run in their own threads
+ * connected by bounded queues, so decoding and encoding overlap the
+ * equalization of other images.
+ *
+ * @param input_dir is the input directory.
+ * @param output_dir is the output directory. It must exist.
+ * @param s is the slope factor.
+ * @param radius set the cell radius to 2^radius.
+ * @param sliding use a sliding window.
+ * @param fixed_point interpolate the cell transforms with fixed point weights.
+ * @param queue_size is the maximum number of images waiting between two stages.
+ * @return the program exit code.
+ */
+int process_directory(const cv::String &input_dir, const cv::String &output_dir,
+                      float s, int radius, bool sliding, bool fixed_point,
+                      int queue_size)
+{
+  std::vector<cv::String> files;
+  cv::glob(input_dir + "/*", files, false);
+  if (files.empty())
+  {
+    std::cerr << "Error: no files found in the input directory." << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  typedef std::chrono::steady_clock Clock;
+  BoundedQueue<BatchItem> decoded(std::max(1, queue_size));
+  BoundedQueue<BatchItem> equalized(std::max(1, queue_size));
+  double read_time = 0.0, process_time = 0.0, write_time = 0.0;
+  int n_read = 0, n_written = 0;
+  std::atomic<int> n_errors(0);
+  const Clock::time_point start = Clock::now();
+
+  {
+    // Stops and joins the stages when leaving the block, also by an exception,
+    // so the threads are never destroyed while joinable.
+    struct StageGuard
+    {
+      BoundedQueue<BatchItem> &decoded;
+      BoundedQueue<BatchItem> &equalized;
+      std::thread reader;
+      std::thread processor;
+      ~StageGuard()
+      {
+        decoded.abort();
+        equalized.abort();
+        if (reader.joinable())
+          reader.join();
+        if (processor.joinable())
+          processor.join();
+      }
+    } stages = {decoded, equalized, std::thread(), std::thread()};
+
+    // A failure with an image is counted as an error and the batch goes on.
+    stages.reader = std::thread([&]()
+    {
+      for (size_t i = 0; i < files.size(); ++i)
+      {
+        BatchItem item;
+        try
+        {
+          const Clock::time_point t0 = Clock::now();
+          item.img = cv::imread(files[i], cv::IMREAD_ANYCOLOR);
+          read_time += std::chrono::duration<double>(Clock::now() - t0).count();
+        }
+        catch (std::exception &e)
+        {
+          std::cerr << "Error: could not read '" << files[i] << "': " << e.what() << std::endl;
+          ++n_errors;
+          continue;
+        }
+        if (item.img.empty())
+        {
+          std::cerr << "Warning: skipping '" << files[i] << "', it is not an image." << std::endl;
+          continue;
+        }
+        const size_t sep = files[i].find_last_of("/\\");
+        item.name = output_dir + "/" + (sep == cv::String::npos ? files[i] : files[i].substr(sep + 1));
+        ++n_read;
+        if (!decoded.push(item))
+          break;
+      }
+      decoded.close();
+    });
+
+    stages.processor = std::thread([&]()
+    {
+      BatchItem item;
+      while (decoded.pop(item))
+      {
+        try
+        {
+          const Clock::time_point t0 = Clock::now();
+          std::vector<cv::Mat> channels;
+          const cv::Mat luma = get_luma(item.img, channels);
+          int r = std::max(0, std::min(radius, int(std::log(std::min(luma.rows, luma.cols)))));
+          r = r == 0 ? 0 : 1 << r;
+          const cv::Mat out = (sliding && r > 0) ? fsiv_clahe_sliding_window(luma, s, r)
+                                                 : fsiv_clahe(luma, s, r, fixed_point);
+          item.img = set_luma(out, channels);
+          process_time += std::chrono::duration<double>(Clock::now() - t0).count();
+        }
+        catch (std::exception &e)
+        {
+          std::cerr << "Error: could not equalize '" << item.name << "': " << e.what() << std::endl;
+          ++n_errors;
+          continue;
+        }
+        if (!equalized.push(item))
+          break;
+      }
+      equalized.close();
+    });
+
+    BatchItem item;
+    while (equalized.pop(item))
+    {
+      bool ok = false;
+      const Clock::time_point t0 = Clock::now();
+      try
+      {
+        ok = cv::imwrite(item.name, item.img);
+      }
+      catch (std::exception &e)
+      {
+        std::cerr << "Error: " << e.what() << std::endl;
+      }
+      write_time += std::chrono::duration<double>(Clock::now() - t0).count();
+      if (ok)
+        ++n_written;
+      else
+      {
+        std::cerr << "Error: could not save the result in file '" << item.name << "'." << std::endl;
+        ++n_errors;
+      }
+    }
+  }
+
+  const double total_time = std::chrono::duration<double>(Clock::now() - start).count();
+  const double n = std::max(1, n_read);
+  std::cout << "Images processed   : " << n_written << " of " << files.size() << " files" << std::endl;
+  std::cout << "Read stage (ms)    : " << 1000.0 * read_time / n << " per image" << std::endl;
+  std::cout << "Process stage (ms) : " << 1000.0 * process_time / n << " per image" << std::endl;
+  std::cout << "Write stage (ms)   : " << 1000.0 * write_time / n << " per image" << std::endl;
+  std::cout << "Total time (s)     : " << total_time << std::endl;
+  std::cout << "Throughput (img/s) : " << n_written / total_time << std::endl;
+  return n_errors == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
 void on_change_s(int v, void *data_)
 {
   UserData *data = static_cast<UserData *>(data_);
@@ -89,6 +546,14 @@ int main(int argc, char *const *argv)
     int radius = parser.get<int>("r");
     float slope_factor = parser.get<float>("s");
     bool interactive = parser.has("i");
+    bool sliding = parser.has("w");
+    bool fixed_point = parser.has("x");
+    bool video = parser.has("v");
+    float change_th = parser.get<float>("t");
+    float alpha = parser.get<float>("a");
+    int strip_rows = parser.get<int>("g");
+    bool batch = parser.has("b");
+    int queue_size = parser.get<int>("q");
 
     if (!parser.check())
     {
@@ -96,6 +561,22 @@ int main(int argc, char *const *argv)
       return 0;
     }
 
+    if (batch)
+      return process_directory(input_name, output_name,
+                               std::max(0.0f, std::min(10.0f, slope_factor)),
+                               radius, sliding, fixed_point, queue_size);
+
+    if (strip_rows > 0)
+      return process_strips(input_name, output_name,
+                            std::max(0.0f, std::min(10.0f, slope_factor)),
+                            radius, strip_rows);
+
+    if (video)
+      return process_video(input_name, output_name,
+                           std::max(0.0f, std::min(10.0f, slope_factor)),
+                           radius, change_th,
+                           std::max(0.01f, std::min(1.0f, alpha)), interactive);
+
     UserData data;
     data.in = cv::imread(input_name, cv::IMREAD_ANYCOLOR);
     if (data.in.empty())
@@ -106,6 +587,8 @@ int main(int argc, char *const *argv)
 
     data.out = data.in.clone();
     data.interactive = interactive;
+    data.sliding = sliding;
+    data.fixed_point = fixed_point;
     data.s = std::max(0.0f, std::min(10.0f, slope_factor));
     radius = std::max(0, std::min(radius, int(std::log(std::min(data.in.rows, data.in.cols)))));
     data.r = radius == 0 ? 0 : 1 << radius;
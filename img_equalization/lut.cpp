@@ -0,0 +1,116 @@
+/**
+ * @file lut.cpp
+ * @brief Apply a lookup table per channel to multi-channel images.
+ * @version 1.0
+ * @date 2024-09-13
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include "lut.hpp"
+#include <algorithm>
+#include <opencv2/core/utility.hpp>
+
+/**
+ * @brief Check the preconditions and get the table of each channel.
+ * @param img is the image to transform.
+ * @param lkts are the tables.
+ * @param tabs are set to the table of each channel.
+ */
+static void get_channel_tables(const cv::Mat &img, const std::vector<cv::Mat> &lkts,
+                               const uchar *tabs[4])
+{
+    CV_Assert(img.depth() == CV_8U && 1 <= img.channels() && img.channels() <= 4);
+    CV_Assert(lkts.size() == 1 || int(lkts.size()) == img.channels());
+    for (size_t i = 0; i < lkts.size(); ++i)
+        CV_Assert(lkts[i].type() == CV_8UC1 && lkts[i].total() == 256 && lkts[i].isContinuous());
+    for (int c = 0; c < 4; ++c)
+        tabs[c] = lkts[lkts.size() == 1 ? 0 : std::min(c, img.channels() - 1)].ptr<uchar>();
+}
+
+/**
+ * @brief Transform a range of image rows.
+ * @param img is the image to transform.
+ * @param tabs are the table of each channel.
+ * @param rows is the range of rows.
+ */
+static void apply_rows(cv::Mat &img, const uchar *const tabs[4], const cv::Range &rows)
+{
+    const uchar *t0 = tabs[0], *t1 = tabs[1], *t2 = tabs[2], *t3 = tabs[3];
+    const int cn = img.channels();
+    const int cols = img.cols;
+    for (int y = rows.start; y < rows.end; ++y)
+    {
+        uchar *p = img.ptr<uchar>(y);
+        int x = 0;
+        // Four pixels per iteration with the channel tables fixed at
+        // compile time, so the loads of the next pixels do not wait.
+        switch (cn)
+        {
+        case 1:
+            for (; x <= cols - 4; x += 4, p += 4)
+            {
+                const uchar v0 = t0[p[0]], v1 = t0[p[1]], v2 = t0[p[2]], v3 = t0[p[3]];
+                p[0] = v0; p[1] = v1; p[2] = v2; p[3] = v3;
+            }
+            for (; x < cols; ++x, ++p)
+                p[0] = t0[p[0]];
+            break;
+        case 2:
+            for (; x <= cols - 2; x += 2, p += 4)
+            {
+                const uchar v0 = t0[p[0]], v1 = t1[p[1]], v2 = t0[p[2]], v3 = t1[p[3]];
+                p[0] = v0; p[1] = v1; p[2] = v2; p[3] = v3;
+            }
+            for (; x < cols; ++x, p += 2)
+                p[0] = t0[p[0]], p[1] = t1[p[1]];
+            break;
+        case 3:
+            for (; x <= cols - 4; x += 4, p += 12)
+            {
+                const uchar v0 = t0[p[0]], v1 = t1[p[1]], v2 = t2[p[2]];
+                const uchar v3 = t0[p[3]], v4 = t1[p[4]], v5 = t2[p[5]];
+                const uchar v6 = t0[p[6]], v7 = t1[p[7]], v8 = t2[p[8]];
+                const uchar v9 = t0[p[9]], v10 = t1[p[10]], v11 = t2[p[11]];
+                p[0] = v0; p[1] = v1; p[2] = v2; p[3] = v3; p[4] = v4; p[5] = v5;
+                p[6] = v6; p[7] = v7; p[8] = v8; p[9] = v9; p[10] = v10; p[11] = v11;
+            }
+            for (; x < cols; ++x, p += 3)
+                p[0] = t0[p[0]], p[1] = t1[p[1]], p[2] = t2[p[2]];
+            break;
+        default:
+            for (; x <= cols - 2; x += 2, p += 8)
+            {
+                const uchar v0 = t0[p[0]], v1 = t1[p[1]], v2 = t2[p[2]], v3 = t3[p[3]];
+                const uchar v4 = t0[p[4]], v5 = t1[p[5]], v6 = t2[p[6]], v7 = t3[p[7]];
+                p[0] = v0; p[1] = v1; p[2] = v2; p[3] = v3;
+                p[4] = v4; p[5] = v5; p[6] = v6; p[7] = v7;
+            }
+            for (; x < cols; ++x, p += 4)
+                p[0] = t0[p[0]], p[1] = t1[p[1]], p[2] = t2[p[2]], p[3] = t3[p[3]];
+            break;
+        }
+    }
+}
+
+void fsiv_apply_lookup_tables(cv::Mat &img, const std::vector<cv::Mat> &lkts)
+{
+    const uchar *tabs[4];
+    get_channel_tables(img, lkts, tabs);
+    cv::parallel_for_(cv::Range(0, img.rows), [&](const cv::Range &range)
+    {
+        apply_rows(img, tabs, range);
+    });
+}
+
+void fsiv_apply_lookup_tables(std::vector<cv::Mat> &imgs, const std::vector<cv::Mat> &lkts)
+{
+    std::vector<const uchar *> tabs(imgs.size() * 4);
+    for (size_t i = 0; i < imgs.size(); ++i)
+        get_channel_tables(imgs[i], lkts, &tabs[i * 4]);
+    cv::parallel_for_(cv::Range(0, int(imgs.size())), [&](const cv::Range &range)
+    {
+        for (int i = range.start; i < range.end; ++i)
+            apply_rows(imgs[i], &tabs[i * 4], cv::Range(0, imgs[i].rows));
+    });
+}
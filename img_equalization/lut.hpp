@@ -0,0 +1,43 @@
+/**
+ * @file lut.hpp
+ * @brief Apply a lookup table per channel to multi-channel images.
+ * @version 1.0
+ * @date 2024-09-13
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Apply a lookup table to each channel of an image in place.
+ *
+ * The interleaved pixels are transformed directly, so there is no need to
+ * split and merge the channels. The image rows are processed in parallel.
+ *
+ * The lookups are scalar, not vectorized: SSE, NEON and the OpenCV universal
+ * intrinsics have no byte gather (v_lut is emulated with scalar loads), and a
+ * 256 entries table does not fit in a byte shuffle. Instead, the loop is
+ * unrolled over several pixels so their loads do not depend on each other.
+ *
+ * @param img is the image to transform.
+ * @param lkts are the tables, one per channel. If only one table is given,
+ *        it is applied to all the channels.
+ * @pre img.depth()==CV_8U && 1<=img.channels() && img.channels()<=4
+ * @pre lkts.size()==1 || lkts.size()==img.channels()
+ * @pre each table is a continuous CV_8UC1 Mat with 256 elements.
+ */
+void fsiv_apply_lookup_tables(cv::Mat &img, const std::vector<cv::Mat> &lkts);
+
+/**
+ * @brief Apply a lookup table to each channel of a batch of images in place.
+ *
+ * The images are processed in parallel.
+ *
+ * @param imgs are the images to transform. They can have different sizes.
+ * @param lkts are the tables, one per channel, or only one for all the channels.
+ * @pre each image holds the preconditions of fsiv_apply_lookup_tables().
+ */
+void fsiv_apply_lookup_tables(std::vector<cv::Mat> &imgs, const std::vector<cv::Mat> &lkts);
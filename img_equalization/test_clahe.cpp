@@ -0,0 +1,310 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <exception>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "common_code.hpp"
+#include "clahe.hpp"
+
+// Reference CLAHE: the per pixel interpolation of the first fsiv_clahe version.
+
+static uchar my_interpolate_corner(const cv::Mat &in,
+                                   const std::vector<cv::Mat> &lkts, const cv::Point &p,
+                                   const cv::Size &cell_size, const cv::Size &grid_size)
+{
+    const int cell_y = p.y / cell_size.height;
+    const int cell_x = p.x / cell_size.width;
+    const int h_idx = cell_y * grid_size.width + cell_x;
+    return lkts[h_idx].at<uchar>(in.at<uchar>(p));
+}
+
+static uchar my_linear_interpolate_rows(const cv::Mat &in,
+                                        const std::vector<cv::Mat> &lkts, const cv::Point &p,
+                                        const cv::Size &cell_size, const cv::Size &grid_size)
+{
+    const int x_off = cell_size.width >> 1;
+    const int y_off = cell_size.height >> 1;
+    const int cell_y = (p.y - y_off) / cell_size.height;
+    int cell1_x = (p.x - x_off) / cell_size.width;
+    const int cell2_x = cell1_x + 1;
+    const float center2_x = cell2_x * cell_size.width + x_off;
+    const float w1 = (center2_x - p.x) / cell_size.width;
+    const float w2 = 1.0 - w1;
+    const int idx1 = cell_y * grid_size.width + cell1_x;
+    const int idx2 = cell_y * grid_size.width + cell2_x;
+    const uchar in_v = in.at<uchar>(p);
+    uchar out = w1 * lkts[idx1].at<uchar>(in_v) +
+                w2 * lkts[idx2].at<uchar>(in_v);
+    return out;
+}
+
+static uchar my_linear_interpolate_cols(const cv::Mat &in,
+                                        const std::vector<cv::Mat> &lkts, const cv::Point &p,
+                                        const cv::Size &cell_size, const cv::Size &grid_size)
+{
+    const int y_off = cell_size.height >> 1;
+    const int cell_x = p.x / cell_size.width;
+    int cell1_y = (p.y - y_off) / cell_size.height;
+    const int cell2_y = cell1_y + 1;
+    const float center2_y = cell2_y * cell_size.height + y_off;
+    const float w1 = (center2_y - p.y) / cell_size.height;
+    const float w2 = 1.0 - w1;
+    const int idx1 = cell1_y * grid_size.width + cell_x;
+    const int idx2 = cell2_y * grid_size.width + cell_x;
+    const uchar in_v = in.at<uchar>(p);
+    uchar out = w1 * lkts[idx1].at<uchar>(in_v) +
+                w2 * lkts[idx2].at<uchar>(in_v);
+    return out;
+}
+
+static uchar my_bilinear_interpolate(const cv::Mat &in,
+                                     const std::vector<cv::Mat> &lkts, const cv::Point &p,
+                                     const cv::Size &cell_size, const cv::Size &grid_size)
+{
+    const int x_off = cell_size.width >> 1;
+    const int y_off = cell_size.height >> 1;
+    const int cell1_x = (p.x - x_off) / cell_size.width;
+    const int cell1_y = (p.y - y_off) / cell_size.height;
+    const int cell3_x = cell1_x + 1;
+    const int cell3_y = cell1_y + 1;
+    const float center3_x = cell3_x * cell_size.width + x_off;
+    const float center3_y = cell3_y * cell_size.height + y_off;
+    const int idx11 = cell1_y * grid_size.width + cell1_x;
+    const int idx12 = cell1_y * grid_size.width + cell3_x;
+    const int idx22 = cell3_y * grid_size.width + cell3_x;
+    const int idx21 = cell3_y * grid_size.width + cell1_x;
+    const uchar in_v = in.at<uchar>(p);
+    const uchar q11 = lkts[idx11].at<uchar>(in_v);
+    const uchar q12 = lkts[idx12].at<uchar>(in_v);
+    const uchar q22 = lkts[idx22].at<uchar>(in_v);
+    const uchar q21 = lkts[idx21].at<uchar>(in_v);
+    const float w_x = (center3_x - p.x) / cell_size.width;
+    const float out_x1 = w_x * q11 + (1.0f - w_x) * q12;
+    const float out_x2 = w_x * q21 + (1.0f - w_x) * q22;
+    const float w_y = (center3_y - p.y) / cell_size.height;
+    return cv::saturate_cast<uchar>(w_y * out_x1 + (1.0f - w_y) * out_x2);
+}
+
+static uchar my_compute_interpolate_value(const cv::Mat &in,
+                                          const std::vector<cv::Mat> &lkts, const cv::Point &p,
+                                          const cv::Size &cell_size, const cv::Size &grid_size)
+{
+    const int x_off = cell_size.width >> 1;
+    const int y_off = cell_size.height >> 1;
+    const bool inner_y = p.y >= y_off && p.y < (in.rows - y_off - 1);
+    const bool inner_x = p.x >= x_off && p.x < (in.cols - x_off - 1);
+    if (inner_y && inner_x)
+        return my_bilinear_interpolate(in, lkts, p, cell_size, grid_size);
+    if (inner_y)
+        return my_linear_interpolate_cols(in, lkts, p, cell_size, grid_size);
+    if (inner_x)
+        return my_linear_interpolate_rows(in, lkts, p, cell_size, grid_size);
+    return my_interpolate_corner(in, lkts, p, cell_size, grid_size);
+}
+
+static cv::Mat my_fsiv_clahe(const cv::Mat &in_, float s, int radius)
+{
+    const cv::Size cell_size(2 * radius + 1, 2 * radius + 1);
+    cv::Mat in = in_;
+    if ((in_.rows % cell_size.height) != 0 || (in_.cols % cell_size.width) != 0)
+        cv::copyMakeBorder(in_, in, 0, cell_size.height - (in_.rows % cell_size.height),
+                           0, cell_size.width - (in_.cols % cell_size.width),
+                           cv::BORDER_REFLECT101);
+    const cv::Size grid_size(in.cols / cell_size.width, in.rows / cell_size.height);
+    std::vector<cv::Mat> lkts(grid_size.area());
+    for (int cell_row = 0; cell_row < grid_size.height; ++cell_row)
+        for (int cell_col = 0; cell_col < grid_size.width; ++cell_col)
+        {
+            const cv::Rect cell(cell_col * cell_size.width, cell_row * cell_size.height,
+                                cell_size.width, cell_size.height);
+            lkts[cell_row * grid_size.width + cell_col] =
+                fsiv_create_equalization_lookup_table(fsiv_compute_image_histogram(in(cell)), s);
+        }
+    cv::Mat out(in_.size(), CV_8UC1);
+    for (int y = 0; y < in_.rows; ++y)
+        for (int x = 0; x < in_.cols; ++x)
+            out.at<uchar>(y, x) = my_compute_interpolate_value(in, lkts, cv::Point(x, y),
+                                                               cell_size, grid_size);
+    return out;
+}
+
+/**
+ * @brief Generate a random test image: a smooth ramp with noise.
+ */
+static cv::Mat random_image(int rows, int cols, cv::RNG &rng)
+{
+    cv::Mat img(rows, cols, CV_8UC1);
+    const int a = rng.uniform(0, 4);
+    const int b = rng.uniform(0, 4);
+    for (int y = 0; y < rows; ++y)
+        for (int x = 0; x < cols; ++x)
+            img.at<uchar>(y, x) = cv::saturate_cast<uchar>((a * x + b * y) % 200 + rng.uniform(0, 56));
+    return img;
+}
+
+/**
+ * @brief Equalize an image with ClaheStripEqualizer pushing strips of a height.
+ * @param in is the input image.
+ * @param s is the slope factor.
+ * @param radius is the cell radius.
+ * @param strip_rows is the number of rows of each strip (the last one can be shorter).
+ * @return the output rows joined.
+ */
+static cv::Mat strip_clahe(const cv::Mat &in, float s, int radius, int strip_rows)
+{
+    ClaheStripEqualizer eq(in.size(), s, radius);
+    cv::Mat out(0, in.cols, CV_8UC1);
+    for (int y = 0; y < in.rows; y += strip_rows)
+    {
+        const cv::Mat rows = eq.push(in.rowRange(y, std::min(in.rows, y + strip_rows)));
+        if (!rows.empty())
+            out.push_back(rows);
+    }
+    CV_Assert(eq.done());
+    return out;
+}
+
+/**
+ * @brief Compare two images and save the test data if they differ more than a tolerance.
+ * @param label is the test label.
+ * @param img is the input image.
+ * @param my_out is the reference output.
+ * @param your_out is the tested output.
+ * @param tolerance is the maximum allowed absolute difference.
+ * @param tests is the test counter.
+ * @param seed is the random seed, used to name the data file of a fail.
+ * @return true if the test passes.
+ */
+static bool check(const std::string &label, const cv::Mat &img,
+                  const cv::Mat &my_out, const cv::Mat &your_out,
+                  double tolerance, int tests, cv::uint64_t seed)
+{
+    std::cout << label << " ... ";
+    const double norm_v = cv::norm(my_out, your_out, cv::NORM_INF);
+    if (your_out.size() == my_out.size() && norm_v <= tolerance)
+    {
+        std::cout << " Ok!" << std::endl;
+        return true;
+    }
+    std::ostringstream fname;
+    fname << "test-" << tests << '-' << seed << ".xml";
+    std::cerr << "Test fail: cv::norm(my_out, your_out, cv::NORM_INF)=" << norm_v
+              << " (should be <= " << tolerance << "!)" << std::endl;
+    std::cerr << "\t test data file: " << fname.str() << std::endl;
+    auto file = cv::FileStorage();
+    file.open(fname.str(), cv::FileStorage::WRITE);
+    file << "Linf" << norm_v;
+    file << "img" << img;
+    file << "my_out" << my_out;
+    file << "your_out" << your_out;
+    file.release();
+    return false;
+}
+
+int main(int argc, char *const *argv)
+{
+    int retCode = EXIT_SUCCESS;
+    int tests_passed = 0;
+    int tests = 0;
+    cv::uint64_t seed = 0;
+    if (argc > 1)
+        seed = static_cast<cv::uint64_t>(std::atoll(argv[1]));
+    else
+        seed = cv::getTickCount();
+    std::cerr << "Random seed: " << seed << std::endl;
+    cv::RNG rng(seed);
+
+    // Image sizes (rows, cols) and radius: odd sizes, sizes that are not a
+    // multiple of the cell size and exact grids.
+    const int cases[][3] = {{37, 53, 2}, {64, 64, 3}, {101, 77, 5}, {45, 45, 7},
+                            {30, 121, 4}, {121, 30, 1}, {99, 100, 9}};
+    const float slopes[] = {0.0f, 2.0f, 4.0f};
+
+    try
+    {
+        for (const auto &c : cases)
+            for (const float s : slopes)
+            {
+                const cv::Mat img = random_image(c[0], c[1], rng);
+                std::ostringstream params;
+                params << "(" << c[0] << "x" << c[1] << ", r=" << c[2] << ", s=" << s << ")";
+                const cv::Mat my_out = my_fsiv_clahe(img, s, c[2]);
+
+                try
+                {
+                    tests++;
+                    const cv::Mat your_out = fsiv_clahe(img, s, c[2]);
+                    if (check("fsiv_clahe " + params.str(), img, my_out, your_out, 0.0, tests, seed))
+                        tests_passed++;
+                }
+                catch (std::exception &e)
+                {
+                    std::cerr << "Error: " << e.what() << std::endl;
+                }
+                catch (...)
+                {
+                    std::cerr << "Error: unknown exception!!." << std::endl;
+                }
+
+                try
+                {
+                    tests++;
+                    const cv::Mat your_out = fsiv_clahe(img, s, c[2], true);
+                    if (check("fsiv_clahe fixed point " + params.str(), img, my_out, your_out, 1.0, tests, seed))
+                        tests_passed++;
+                }
+                catch (std::exception &e)
+                {
+                    std::cerr << "Error: " << e.what() << std::endl;
+                }
+                catch (...)
+                {
+                    std::cerr << "Error: unknown exception!!." << std::endl;
+                }
+
+                // Strips of one row, shorter and longer than a cell, and the
+                // whole image.
+                const int strip_rows[] = {1, 2 * c[2], 3 * c[2] + 4, c[0]};
+                for (const int n : strip_rows)
+                {
+                    try
+                    {
+                        tests++;
+                        std::ostringstream label;
+                        label << "ClaheStripEqualizer " << params.str() << " strips of " << n << " rows";
+                        const cv::Mat your_out = strip_clahe(img, s, c[2], n);
+                        if (check(label.str(), img, my_out, your_out, 0.0, tests, seed))
+                            tests_passed++;
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "Error: unknown exception!!." << std::endl;
+                    }
+                }
+            }
+
+        std::cout << "You pass " << tests_passed << " of " << tests << " tests." << std::endl;
+        if (tests_passed != tests)
+            retCode = EXIT_FAILURE;
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    catch (...)
+    {
+        std::cerr << "Error: unknown exception!!." << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    return retCode;
+}
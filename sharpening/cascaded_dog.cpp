@@ -0,0 +1,119 @@
+/**
+ * @file cascaded_dog.cpp
+ * @brief Difference of Gaussians computed with cascaded Gaussian blurs.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include "cascaded_dog.hpp"
+#include "convolution.hpp"
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+// Radius of the incremental Gaussian kernels, in sigmas.
+static const double KERNEL_SIGMAS = 3.0;
+
+/**
+ * @brief Get the 1D Gaussian kernel used by the filter of a radius.
+ */
+static cv::Mat radius_kernel(int r)
+{
+    return cv::getGaussianKernel(2 * r + 1, -1, CV_32F);
+}
+
+/**
+ * @brief Get the variance of a centered 1D kernel.
+ */
+static double kernel_variance(const cv::Mat &k)
+{
+    const int h = k.rows / 2;
+    double var = 0.0;
+    for (int i = 0; i < k.rows; ++i)
+        var += k.at<float>(i) * double(i - h) * (i - h);
+    return var;
+}
+
+/**
+ * @brief Blur with the outer product of a 1D kernel.
+ *
+ * The kernel is applied as two 1D passes, without building the 2D filter.
+ */
+static cv::Mat separable_blur(const cv::Mat &in, const cv::Mat &k, bool circular)
+{
+    return fsiv_separable_border_filter2D(in, k, k.t(), circular);
+}
+
+std::vector<cv::Mat>
+fsiv_gaussian_scale_stack(const cv::Mat &in, const std::vector<int> &radii,
+                          bool circular)
+{
+    CV_Assert(in.type() == CV_32FC1);
+    CV_Assert(!radii.empty() && radii[0] > 0);
+
+    // The incremental kernels, each one with the variance to be added.
+    std::vector<cv::Mat> kernels(1, radius_kernel(radii[0]));
+    double var = kernel_variance(kernels[0]);
+    int margin = 0;
+    for (size_t i = 1; i < radii.size(); ++i)
+    {
+        CV_Assert(radii[i - 1] < radii[i]);
+        const double target = kernel_variance(radius_kernel(radii[i]));
+        const double sigma = std::sqrt(target - var);
+        const int r = std::max(1, int(std::ceil(KERNEL_SIGMAS * sigma)));
+        kernels.push_back(cv::getGaussianKernel(2 * r + 1, sigma, CV_32F));
+        margin += r;
+        var = target;
+    }
+
+    // With zero padding, a blurred level is not zero outside the image, so
+    // the levels are computed on an image padded with the cascade's radius.
+    cv::Mat src = in;
+    if (!circular && margin > 0)
+    {
+        src = cv::Mat::zeros(in.rows + 2 * margin, in.cols + 2 * margin, CV_32FC1);
+        in.copyTo(src(cv::Rect(margin, margin, in.cols, in.rows)));
+    }
+    else
+        margin = 0;
+
+    std::vector<cv::Mat> ret_v;
+    ret_v.reserve(radii.size());
+    cv::Mat level = src;
+    for (size_t i = 0; i < kernels.size(); ++i)
+    {
+        level = separable_blur(level, kernels[i], circular);
+        ret_v.push_back(level(cv::Rect(margin, margin, in.cols, in.rows)));
+    }
+
+    for (size_t i = 0; i < ret_v.size(); ++i)
+    {
+        CV_Assert(ret_v[i].type() == CV_32FC1);
+        CV_Assert(ret_v[i].size() == in.size());
+    }
+    return ret_v;
+}
+
+std::vector<cv::Mat>
+fsiv_dog_scale_stack(const cv::Mat &in, const std::vector<int> &radii,
+                     bool circular)
+{
+    CV_Assert(radii.size() >= 2);
+    const std::vector<cv::Mat> blurs = fsiv_gaussian_scale_stack(in, radii, circular);
+    std::vector<cv::Mat> ret_v(blurs.size() - 1);
+    for (size_t i = 0; i < ret_v.size(); ++i)
+        ret_v[i] = blurs[i + 1] - blurs[i];
+    return ret_v;
+}
+
+cv::Mat
+fsiv_cascaded_dog(const cv::Mat &in, int r1, int r2, bool circular)
+{
+    CV_Assert(0 < r1 && r1 < r2);
+    std::vector<int> radii(2);
+    radii[0] = r1;
+    radii[1] = r2;
+    return fsiv_dog_scale_stack(in, radii, circular)[0];
+}
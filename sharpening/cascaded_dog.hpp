@@ -0,0 +1,88 @@
+/**
+ * @file cascaded_dog.hpp
+ * @brief Difference of Gaussians computed with cascaded Gaussian blurs.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Blur an image at several scales by cascading Gaussian filters.
+ *
+ * Level 0 is the image blurred with the Gaussian filter of radius radii[0]
+ * (cv::getGaussianKernel(2*r+1, -1)). Level i is level i-1 blurred again with
+ * a Gaussian whose variance is the difference between the variances of the
+ * radii[i] and radii[i-1] filters, because the variances of cascaded
+ * Gaussians add. Each level costs O(sigma increment) per pixel instead of
+ * O(radii[i]).
+ *
+ * Level 0 is exact. The incremental blurs are sampled Gaussians, so the other
+ * levels are not: for images of uniform noise in [0, 1], the maximum absolute
+ * difference between level i and the Gaussian filter of radius radii[i] is
+ * below:
+ *
+ * | radii[i]     | 1..3 | 4    | 5     | 6..7  | 8..15 | >=16  |
+ * |--------------|------|------|-------|-------|-------|-------|
+ * | random noise | 0.02 | 0.01 | 0.008 | 0.006 | 0.005 | 0.004 |
+ *
+ * test_cascaded_dog checks these bounds.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] radii are the radii of the levels.
+ * @arg[in] circular if it is true, use circular convolution, else zero padding.
+ * @return the blurred images, one per radius.
+ * @pre in.type()==CV_32FC1
+ * @pre !radii.empty() && 0<radii[0] && radii[i-1]<radii[i]
+ * @post ret[i].type()==CV_32FC1 && ret[i].size()==in.size()
+ */
+std::vector<cv::Mat> fsiv_gaussian_scale_stack(const cv::Mat &in,
+                                               const std::vector<int> &radii,
+                                               bool circular = false);
+
+/**
+ * @brief Get the DoG responses of an image at several scales.
+ *
+ * The Gaussian scale stack is computed once and each DoG response is the
+ * difference of two consecutive levels, so the error of ret[i] is below the
+ * sum of the errors of the levels radii[i] and radii[i+1] (see
+ * fsiv_gaussian_scale_stack).
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] radii are the radii of the Gaussian levels.
+ * @arg[in] circular if it is true, use circular convolution, else zero padding.
+ * @return radii.size()-1 images, ret[i] = G(radii[i+1]) - G(radii[i]).
+ * @pre in.type()==CV_32FC1
+ * @pre radii.size()>=2 && 0<radii[0] && radii[i-1]<radii[i]
+ * @post ret[i].type()==CV_32FC1 && ret[i].size()==in.size()
+ */
+std::vector<cv::Mat> fsiv_dog_scale_stack(const cv::Mat &in,
+                                          const std::vector<int> &radii,
+                                          bool circular = false);
+
+/**
+ * @brief Get the DoG response of an image with cascaded Gaussian blurs.
+ *
+ * The r2 blur is derived from the r1 blur, so the cost is O(r2) per pixel
+ * instead of the O(r2^2) of correlating with fsiv_create_dog_filter(r1, r2).
+ * The r1 blur is exact, so the error is the one of the r2 level of
+ * fsiv_gaussian_scale_stack: for images of uniform noise in [0, 1] it is below
+ * 0.02 for r2<=3 and below 0.008 when r2>=5. For any image in [0, 1] it is
+ * below the L1 norm of the kernel difference, which is at most 0.08 (r1=1,
+ * r2=3) and below 0.04 when r2>=5.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] r1 is the radius of the first Gaussian filter.
+ * @arg[in] r2 is the radius of the second Gaussian filter.
+ * @arg[in] circular if it is true, use circular convolution, else zero padding.
+ * @return G(r2) - G(r1).
+ * @pre in.type()==CV_32FC1
+ * @pre 0<r1<r2
+ * @post ret.type()==CV_32FC1 && ret.size()==in.size()
+ */
+cv::Mat fsiv_cascaded_dog(const cv::Mat &in, int r1, int r2,
+                          bool circular = false);
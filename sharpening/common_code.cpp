@@ -1,5 +1,10 @@
 #include <iostream>
 #include "common_code.hpp"
+#include "cascaded_dog.hpp"
+#include "convolution.hpp"
+#include "fft_convolution.hpp"
+#include "laplacian_stencil.hpp"
+#include "recursive_gaussian.hpp"
 #include <opencv2/imgproc.hpp>
 
 cv::Mat
@@ -125,11 +130,52 @@ cv::Mat
 fsiv_image_sharpening(const cv::Mat &in, int filter_type,
                       int r1, int r2, bool circular)
 {
-    CV_Assert(in.type() == CV_32FC1);
+    CV_Assert(in.type() == CV_32FC1 || (in.type() == CV_8UC1 && filter_type <= 1));
     CV_Assert(0 < r1 && r1 < r2);
-    CV_Assert(0 <= filter_type && filter_type <= 2);
+    CV_Assert(0 <= filter_type && filter_type <= 4);
     cv::Mat out;
 
+    const int r = (filter_type == 2) ? r2 : 1;
+    const cv::Size filter_size(2 * r + 1, 2 * r + 1);
+    if (filter_type <= 1)
+    {
+        // 3x3 Laplacian filters: compile time stencils, no expanded image.
+        // 8-bit images are computed with integers.
+        out = fsiv_laplacian_sharpening(in, filter_type, circular);
+    }
+    else if (filter_type == 3)
+    {
+        // in*(delta + G(r1) - G(r2)) with blurs whose cost does not depend
+        // on the radius.
+        const cv::Mat g1 = fsiv_recursive_gaussian_blur(in, fsiv_gaussian_sigma(r1), circular);
+        const cv::Mat g2 = fsiv_recursive_gaussian_blur(in, fsiv_gaussian_sigma(r2), circular);
+        out = in + g1 - g2;
+    }
+    else if (filter_type == 4)
+    {
+        // in*(delta - DoG) with the r2 blur derived from the r1 blur.
+        out = in - fsiv_cascaded_dog(in, r1, r2, circular);
+    }
+    else if (circular && fsiv_fft_is_faster(in.size(), filter_size, false, true))
+    {
+        // The DFT is periodic, so the circular expansion is not needed.
+        out = fsiv_fft_circular_filter2D(in, fsiv_create_sharpening_filter(filter_type, r1, r2));
+    }
+    else if (!circular && fsiv_fft_is_faster(cv::Size(in.cols + 2 * r, in.rows + 2 * r),
+                                             filter_size))
+    {
+        // Large DoG filters are cheaper in the frequency domain.
+        const cv::Mat filter = fsiv_create_sharpening_filter(filter_type, r1, r2);
+        out = fsiv_fft_filter2D(fsiv_fill_expansion(in, r), filter);
+    }
+    else if (fsiv_get_virtual_borders())
+    {
+        // Filter with a virtual border instead of expanding the image.
+        out = fsiv_border_filter2D(in, fsiv_create_sharpening_filter(filter_type, r1, r2),
+                                   circular);
+    }
+    else
+    {
     //! TODO
     // Remember: The effect consists of performing a convolution of the input
     //           image with the appropriate sharpening filter.
@@ -141,6 +187,7 @@ fsiv_image_sharpening(const cv::Mat &in, int filter_type,
     //           cv::Mat::copyTo on a centered window to extract the result.
 
     //
+    }
     CV_Assert(out.type() == in.type());
     CV_Assert(out.size() == in.size());
     return out;
@@ -77,13 +77,16 @@ cv::Mat fsiv_create_sharpening_filter(int filter_type, int r1, int r2);
 /**
  * @brief Do a sharpening enhance to an image.
  * @param img is the input image.
- * @param filter_type is the sharpening filter to use: 0->LAP_4, 1->LAP_8, 2->DOG.
+ * @param filter_type is the sharpening filter to use: 0->LAP_4, 1->LAP_8, 2->DOG,
+ *        3->DOG computed with recursive Gaussians (see recursive_gaussian.hpp),
+ *        4->DOG computed with cascaded Gaussians (see cascaded_dog.hpp).
  * @param r1 if filter type is DOG, is the radius of first Gaussian filter.
  * @param r2 if filter type is DOG, is the radius of second Gaussian filter.
  * @param circular if it is true, use circular convolution.
- * @return the enhanced image.
- * @pre filter_type in {0,1,2}.
+ * @return the enhanced image, with the same type as the input.
+ * @pre filter_type in {0,1,2,3,4}.
  * @pre 0<r1<r2
+ * @pre in.type()==CV_32FC1 || (in.type()==CV_8UC1 && filter_type in {0,1})
  */
 cv::Mat fsiv_image_sharpening(const cv::Mat &in, int filter_type,
                               int r1, int r2, bool circular);
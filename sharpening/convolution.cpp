@@ -0,0 +1,593 @@
+/**
+ * @file convolution.cpp
+ * @brief Fast paths to compute the digital correlation of an image.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include "convolution.hpp"
+#include <algorithm>
+#include <vector>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+// Number of rows filtered together so the transposed writes are contiguous.
+static const int TRANSPOSE_BLOCK = 16;
+
+// Bytes of the input tile (output tile plus halo) read by a thread.
+static const int L2_TILE_BYTES = 256 * 1024;
+
+// Maximum output tile width.
+static const int TILE_COLS = 256;
+
+// Minimum output rows of a separable tile. A tile also filters the rows of the
+// column filter's halo.
+static const int BAND_ROWS = 128;
+
+static bool virtual_borders = true;
+static bool tiled_convolution = true;
+
+/**
+ * @brief Unsharp masking done on the fly by the last filter pass.
+ *
+ * The pass computes out = a*in + b*blur instead of blur, and also stores blur
+ * in mask when it is not nullptr.
+ */
+typedef struct
+{
+    const cv::Mat *in;
+    float a;
+    float b;
+    cv::Mat *mask;
+} UsmEpilogue;
+
+/**
+ * @brief Map an index of the expanded image to the source image.
+ * @param i is the index, maybe out of [0, n).
+ * @param n is the source size.
+ * @param circular if the border wraps around.
+ * @return the source index, or -1 for a zero border.
+ */
+static inline int border_index(int i, int n, bool circular)
+{
+    if (i >= 0 && i < n)
+        return i;
+    if (!circular)
+        return -1;
+    i %= n;
+    return i < 0 ? i + n : i;
+}
+
+/**
+ * @brief Apply the unsharp masking to a segment of a row.
+ * @param usm is the unsharp masking.
+ * @param y is the row.
+ * @param x0 is the first column of the segment.
+ * @param n is the number of columns of the segment.
+ * @param blur is the blurred segment.
+ * @param out is the output segment.
+ */
+static inline void usm_epilogue_row(const UsmEpilogue &usm, int y, int x0, int n,
+                                    const float *blur, float *out)
+{
+    const float *orig = usm.in->ptr<float>(y) + x0;
+    for (int x = 0; x < n; ++x)
+        out[x] = usm.a * orig[x] + usm.b * blur[x];
+    if (usm.mask)
+        std::copy(blur, blur + n, usm.mask->ptr<float>(y) + x0);
+}
+
+/**
+ * @brief Copy a segment of an image row extended h pixels at both sides.
+ * @param src is the row.
+ * @param cols is the number of pixels of the row.
+ * @param x0 is the first pixel of the segment.
+ * @param n is the number of pixels of the segment.
+ * @param h is the extension.
+ * @param circular if the border wraps around instead of being zero.
+ * @param ext is the output buffer, with n+2h values for [x0-h, x0+n+h).
+ */
+static void extend_segment(const float *src, int cols, int x0, int n, int h,
+                           bool circular, float *ext)
+{
+    // Positions inside the row are copied, the others are remapped.
+    const int b = std::min(x0 + n + h, std::max(x0 - h, 0));
+    const int e = std::max(b, std::min(x0 + n + h, cols));
+    for (int x = x0 - h; x < b; ++x)
+    {
+        const int sx = border_index(x, cols, circular);
+        ext[x - x0 + h] = sx < 0 ? 0.0f : src[sx];
+    }
+    std::copy(src + b, src + e, ext + b - x0 + h);
+    for (int x = e; x < x0 + n + h; ++x)
+    {
+        const int sx = border_index(x, cols, circular);
+        ext[x - x0 + h] = sx < 0 ? 0.0f : src[sx];
+    }
+}
+
+bool fsiv_separate_filter(cv::Mat const &filter, cv::Mat &col, cv::Mat &row,
+                          double eps)
+{
+    CV_Assert(filter.type() == CV_32FC1);
+    cv::Point max_loc;
+    double min_v, max_v;
+    cv::minMaxLoc(cv::abs(filter), &min_v, &max_v, nullptr, &max_loc);
+    if (max_v == 0.0)
+        return false;
+
+    col = filter.col(max_loc.x).clone();
+    row = filter.row(max_loc.y) * (1.0 / filter.at<float>(max_loc.y, max_loc.x));
+    for (int y = 0; y < filter.rows; ++y)
+        for (int x = 0; x < filter.cols; ++x)
+            if (std::abs(col.at<float>(y) * row.at<float>(x) - filter.at<float>(y, x)) > eps * max_v)
+                return false;
+    return true;
+}
+
+cv::Mat fsiv_dense_filter2D(cv::Mat const &in, cv::Mat const &filter)
+{
+    CV_Assert(in.type() == CV_32FC1 && filter.type() == CV_32FC1);
+    CV_Assert(in.rows >= filter.rows && in.cols >= filter.cols);
+    cv::Mat ret_v(in.rows - 2 * (filter.rows / 2), in.cols - 2 * (filter.cols / 2), CV_32FC1);
+    cv::parallel_for_(cv::Range(0, ret_v.rows), [&](const cv::Range &range)
+    {
+        for (int y = range.start; y < range.end; ++y)
+        {
+            float *dst = ret_v.ptr<float>(y);
+            std::fill(dst, dst + ret_v.cols, 0.0f);
+            // Accumulate a filter coefficient at a time over the whole row,
+            // so the inner loop runs along contiguous memory.
+            for (int i = 0; i < filter.rows; ++i)
+            {
+                const float *k = filter.ptr<float>(i);
+                const float *src = in.ptr<float>(y + i);
+                for (int j = 0; j < filter.cols; ++j)
+                {
+                    const float kv = k[j];
+                    for (int x = 0; x < ret_v.cols; ++x)
+                        dst[x] += kv * src[x + j];
+                }
+            }
+        }
+    });
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.rows == in.rows - 2 * (filter.rows / 2));
+    CV_Assert(ret_v.cols == in.cols - 2 * (filter.cols / 2));
+    return ret_v;
+}
+
+/**
+ * @brief Correlate an image with a dense filter by tiles.
+ *
+ * The output is split in tiles whose input area (with the halo) fits in L2
+ * and the tiles are processed in parallel. Each output is accumulated over
+ * the filter coefficients in the same order as fsiv_dense_filter2D, four
+ * outputs at a time.
+ *
+ * @param in is the input image.
+ * @param filter is the filter.
+ * @param out is the output, with size in.size()-filter.size()+1. It can be a
+ *            region of a larger image.
+ */
+static void tiled_correlation(const cv::Mat &in, const cv::Mat &filter, cv::Mat out)
+{
+    const int kr = filter.rows;
+    const int kc = filter.cols;
+    const int tw = std::min(out.cols, TILE_COLS);
+    const int th = std::min(out.rows, std::max(1, L2_TILE_BYTES / int(sizeof(float) * (tw + kc - 1)) - (kr - 1)));
+    const int n_tx = (out.cols + tw - 1) / tw;
+    const int n_ty = (out.rows + th - 1) / th;
+    const cv::Mat k = filter.clone(); // the filter must be continuous.
+    const float *kp = k.ptr<float>();
+#if CV_SIMD128
+    std::vector<cv::v_float32x4> kv(k.total());
+    for (size_t i = 0; i < k.total(); ++i)
+        kv[i] = cv::v_setall_f32(kp[i]);
+#endif
+    cv::parallel_for_(cv::Range(0, n_tx * n_ty), [&](const cv::Range &range)
+    {
+        for (int t = range.start; t < range.end; ++t)
+        {
+            const int y0 = (t / n_tx) * th;
+            const int y1 = std::min(out.rows, y0 + th);
+            const int x0 = (t % n_tx) * tw;
+            const int x1 = std::min(out.cols, x0 + tw);
+            for (int y = y0; y < y1; ++y)
+            {
+                float *dst = out.ptr<float>(y);
+                int x = x0;
+#if CV_SIMD128
+                for (; x + 4 <= x1; x += 4)
+                {
+                    cv::v_float32x4 acc = cv::v_setzero_f32();
+                    for (int i = 0; i < kr; ++i)
+                    {
+                        const float *src = in.ptr<float>(y + i) + x;
+                        const cv::v_float32x4 *kvi = &kv[i * kc];
+                        for (int j = 0; j < kc; ++j)
+                            acc = acc + kvi[j] * cv::v_load(src + j);
+                    }
+                    cv::v_store(dst + x, acc);
+                }
+#endif
+                for (; x < x1; ++x)
+                {
+                    float sum = 0.0f;
+                    for (int i = 0; i < kr; ++i)
+                    {
+                        const float *src = in.ptr<float>(y + i) + x;
+                        const float *ki = kp + i * kc;
+                        for (int j = 0; j < kc; ++j)
+                            sum += ki[j] * src[j];
+                    }
+                    dst[x] = sum;
+                }
+            }
+        }
+    });
+}
+
+cv::Mat fsiv_tiled_filter2D(cv::Mat const &in, cv::Mat const &filter)
+{
+    CV_Assert(in.type() == CV_32FC1 && filter.type() == CV_32FC1);
+    CV_Assert(in.rows >= filter.rows && in.cols >= filter.cols);
+    cv::Mat ret_v(in.rows - 2 * (filter.rows / 2), in.cols - 2 * (filter.cols / 2), CV_32FC1);
+    tiled_correlation(in, filter, ret_v);
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.rows == in.rows - 2 * (filter.rows / 2));
+    CV_Assert(ret_v.cols == in.cols - 2 * (filter.cols / 2));
+    return ret_v;
+}
+
+/**
+ * @brief Correlate the rows of an image with a 1D filter writing the result transposed.
+ * @param src is the input image.
+ * @param k is the filter.
+ * @param ksize is the filter size.
+ * @return dst with dst(x, y) = sum_i k[i]*src(y, x+i).
+ */
+static cv::Mat filter_rows_transposed(const cv::Mat &src, const float *k, int ksize)
+{
+    cv::Mat dst(src.cols - ksize + 1, src.rows, CV_32FC1);
+    const int n_blocks = (src.rows + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK;
+    cv::parallel_for_(cv::Range(0, n_blocks), [&](const cv::Range &range)
+    {
+        for (int b = range.start; b < range.end; ++b)
+        {
+            const int y0 = b * TRANSPOSE_BLOCK;
+            const int y1 = std::min(src.rows, y0 + TRANSPOSE_BLOCK);
+            for (int x = 0; x < dst.rows; ++x)
+            {
+                float *d = dst.ptr<float>(x);
+                for (int y = y0; y < y1; ++y)
+                {
+                    const float *s = src.ptr<float>(y) + x;
+                    float sum = 0.0f;
+                    for (int i = 0; i < ksize; ++i)
+                        sum += k[i] * s[i];
+                    d[y] = sum;
+                }
+            }
+        }
+    });
+    return dst;
+}
+
+cv::Mat fsiv_separable_filter2D(cv::Mat const &in, cv::Mat const &col,
+                                cv::Mat const &row)
+{
+    CV_Assert(in.type() == CV_32FC1);
+    CV_Assert(col.type() == CV_32FC1 && col.cols == 1);
+    CV_Assert(row.type() == CV_32FC1 && row.rows == 1);
+    CV_Assert(in.rows >= col.rows && in.cols >= row.cols);
+    const cv::Mat col_k = col.clone(); // the column filter must be continuous.
+    // Horizontal pass: transposed result with a row per output column.
+    const cv::Mat tmp = filter_rows_transposed(in, row.ptr<float>(), row.cols);
+    // Vertical pass on the transposed image returns to the image layout.
+    cv::Mat ret_v = filter_rows_transposed(tmp, col_k.ptr<float>(), col_k.rows);
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.rows == in.rows - 2 * (col.rows / 2));
+    CV_Assert(ret_v.cols == in.cols - 2 * (row.cols / 2));
+    return ret_v;
+}
+
+/**
+ * @brief Correlate a row with a dense filter and a virtual border.
+ * @param in is the input image.
+ * @param filter is the filter.
+ * @param circular if the border wraps around instead of being zero.
+ * @param y is the row.
+ * @param dst is the output row.
+ */
+static void dense_row_border(const cv::Mat &in, const cv::Mat &filter,
+                             bool circular, int y, float *dst)
+{
+    const int r = filter.rows / 2;
+    const int c = filter.cols / 2;
+    std::fill(dst, dst + in.cols, 0.0f);
+    for (int i = 0; i < filter.rows; ++i)
+    {
+        const int sy = border_index(y + i - r, in.rows, circular);
+        if (sy < 0)
+            continue;
+        const float *k = filter.ptr<float>(i);
+        const float *src = in.ptr<float>(sy);
+        for (int j = 0; j < filter.cols; ++j)
+        {
+            const float kv = k[j];
+            const int d = j - c;
+            // Interior: x + d is inside the row.
+            const int x0 = std::min(in.cols, std::max(0, -d));
+            const int x1 = std::max(x0, std::min(in.cols, in.cols - d));
+            for (int x = x0; x < x1; ++x)
+                dst[x] += kv * src[x + d];
+            if (!circular)
+                continue;
+            for (int x = 0; x < x0; ++x)
+                dst[x] += kv * src[border_index(x + d, in.cols, true)];
+            for (int x = x1; x < in.cols; ++x)
+                dst[x] += kv * src[border_index(x + d, in.cols, true)];
+        }
+    }
+}
+
+/**
+ * @brief Correlate a pixel with a dense filter and a virtual border.
+ * @return the same value than dense_row_border for the pixel.
+ */
+static float dense_pixel_border(const cv::Mat &in, const cv::Mat &filter,
+                                bool circular, int y, int x)
+{
+    const int r = filter.rows / 2;
+    const int c = filter.cols / 2;
+    float sum = 0.0f;
+    for (int i = 0; i < filter.rows; ++i)
+    {
+        const int sy = border_index(y + i - r, in.rows, circular);
+        if (sy < 0)
+            continue;
+        const float *k = filter.ptr<float>(i);
+        const float *src = in.ptr<float>(sy);
+        for (int j = 0; j < filter.cols; ++j)
+        {
+            const int sx = border_index(x + j - c, in.cols, circular);
+            if (sx >= 0)
+                sum += k[j] * src[sx];
+        }
+    }
+    return sum;
+}
+
+/**
+ * @brief Dense correlation with a virtual border.
+ *
+ * Without unsharp masking, the interior is correlated by tiles and only the
+ * border bands remap the indices.
+ *
+ * @see fsiv_dense_filter2D
+ */
+static cv::Mat dense_filter2D_border(const cv::Mat &in, const cv::Mat &filter,
+                                     bool circular, const UsmEpilogue *usm = nullptr)
+{
+    cv::Mat ret_v(in.size(), CV_32FC1);
+    if (usm == nullptr && tiled_convolution)
+    {
+        const int r = filter.rows / 2;
+        const int c = filter.cols / 2;
+        const int iy0 = std::min(r, in.rows);
+        const int iy1 = std::max(iy0, in.rows - r);
+        const int ix0 = std::min(c, in.cols);
+        const int ix1 = std::max(ix0, in.cols - c);
+        const bool interior = (iy1 > iy0 && ix1 > ix0);
+        if (interior)
+            tiled_correlation(in, filter, ret_v(cv::Rect(ix0, iy0, ix1 - ix0, iy1 - iy0)));
+        cv::parallel_for_(cv::Range(0, ret_v.rows), [&](const cv::Range &range)
+        {
+            for (int y = range.start; y < range.end; ++y)
+            {
+                float *dst = ret_v.ptr<float>(y);
+                if (!interior || y < iy0 || y >= iy1)
+                    dense_row_border(in, filter, circular, y, dst);
+                else
+                {
+                    for (int x = 0; x < ix0; ++x)
+                        dst[x] = dense_pixel_border(in, filter, circular, y, x);
+                    for (int x = ix1; x < in.cols; ++x)
+                        dst[x] = dense_pixel_border(in, filter, circular, y, x);
+                }
+            }
+        });
+        return ret_v;
+    }
+
+    cv::parallel_for_(cv::Range(0, ret_v.rows), [&](const cv::Range &range)
+    {
+        // With unsharp masking the blurred row is accumulated apart.
+        std::vector<float> row_buf(usm ? in.cols : 0);
+        for (int y = range.start; y < range.end; ++y)
+        {
+            float *dst = usm ? row_buf.data() : ret_v.ptr<float>(y);
+            dense_row_border(in, filter, circular, y, dst);
+            if (usm)
+                usm_epilogue_row(*usm, y, 0, in.cols, dst, ret_v.ptr<float>(y));
+        }
+    });
+    return ret_v;
+}
+
+/**
+ * @brief Separable correlation with a virtual border, maybe followed by unsharp masking.
+ *
+ * The output is computed by tiles of a band of rows and a stripe of columns.
+ * A tile walks down its rows keeping the row filtered values of the last
+ * col.rows rows in a ring, so the intermediate image is never stored and only
+ * the input, the output and the mask go through memory. The border pixels are
+ * read from a row segment extended as the expanded image, so the products are
+ * the same and are added in the same order.
+ *
+ * @see fsiv_separable_border_filter2D
+ */
+static cv::Mat separable_border_filter2D(const cv::Mat &in, const cv::Mat &col,
+                                         const cv::Mat &row, bool circular,
+                                         const UsmEpilogue *usm)
+{
+    const cv::Mat col_k = col.isContinuous() ? col : col.clone(); // the column filter must be continuous.
+    const cv::Mat row_k = row.isContinuous() ? row : row.clone();
+    const float *rk = row_k.ptr<float>();
+    const float *ck = col_k.ptr<float>();
+    const int rks = row_k.cols;
+    const int cks = col_k.rows;
+    const int hr = rks / 2;
+    const int hc = cks / 2;
+    const int band_rows = std::max(BAND_ROWS, 4 * cks);
+    const int n_bands = (in.rows + band_rows - 1) / band_rows;
+    const int n_stripes = (in.cols + TILE_COLS - 1) / TILE_COLS;
+    cv::Mat ret_v(in.size(), CV_32FC1);
+    cv::parallel_for_(cv::Range(0, n_bands * n_stripes), [&](const cv::Range &range)
+    {
+        std::vector<float> ext(TILE_COLS + 2 * hr);
+        std::vector<float> ring(cks * TILE_COLS);
+        std::vector<float> acc(TILE_COLS);
+        for (int t = range.start; t < range.end; ++t)
+        {
+            const int y0 = (t / n_stripes) * band_rows;
+            const int y1 = std::min(in.rows, y0 + band_rows);
+            const int x0 = (t % n_stripes) * TILE_COLS;
+            const int n = std::min(TILE_COLS, in.cols - x0);
+
+            // Row pass of the row j of the expanded image into the ring.
+            auto filter_row = [&](int j)
+            {
+                float *dst = &ring[((j - y0 + hc) % cks) * TILE_COLS];
+                std::fill(dst, dst + n, 0.0f);
+                const int sy = border_index(j, in.rows, circular);
+                if (sy < 0)
+                    return;
+                extend_segment(in.ptr<float>(sy), in.cols, x0, n, hr, circular, ext.data());
+                for (int i = 0; i < rks; ++i)
+                {
+                    const float kv = rk[i];
+                    const float *s = ext.data() + i;
+                    for (int x = 0; x < n; ++x)
+                        dst[x] += kv * s[x];
+                }
+            };
+
+            for (int j = y0 - hc; j < y0 + hc; ++j)
+                filter_row(j);
+            for (int y = y0; y < y1; ++y)
+            {
+                filter_row(y + hc);
+                // Column pass over the ring, from the top row.
+                std::fill(acc.begin(), acc.begin() + n, 0.0f);
+                for (int i = 0; i < cks; ++i)
+                {
+                    const float kv = ck[i];
+                    const float *s = &ring[((y - y0 + i) % cks) * TILE_COLS];
+                    for (int x = 0; x < n; ++x)
+                        acc[x] += kv * s[x];
+                }
+                float *out = ret_v.ptr<float>(y) + x0;
+                if (usm)
+                    usm_epilogue_row(*usm, y, x0, n, acc.data(), out);
+                else
+                    std::copy(acc.begin(), acc.begin() + n, out);
+            }
+        }
+    });
+    return ret_v;
+}
+
+/**
+ * @brief Correlation with a virtual border, maybe followed by unsharp masking.
+ * @see fsiv_border_filter2D
+ */
+static cv::Mat border_filter2D(const cv::Mat &in, const cv::Mat &filter,
+                               bool circular, const UsmEpilogue *usm)
+{
+    cv::Mat ret_v;
+    cv::Mat col, row;
+    if (fsiv_separate_filter(filter, col, row))
+        ret_v = separable_border_filter2D(in, col, row, circular, usm);
+    else
+        ret_v = dense_filter2D_border(in, filter, circular, usm);
+    return ret_v;
+}
+
+cv::Mat fsiv_border_filter2D(cv::Mat const &in, cv::Mat const &filter,
+                             bool circular)
+{
+    CV_Assert(in.type() == CV_32FC1 && filter.type() == CV_32FC1);
+    CV_Assert(filter.rows % 2 == 1 && filter.cols % 2 == 1);
+    cv::Mat ret_v = border_filter2D(in, filter, circular, nullptr);
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.size() == in.size());
+    return ret_v;
+}
+
+cv::Mat fsiv_separable_border_filter2D(cv::Mat const &in, cv::Mat const &col,
+                                       cv::Mat const &row, bool circular)
+{
+    CV_Assert(in.type() == CV_32FC1);
+    CV_Assert(col.type() == CV_32FC1 && col.cols == 1 && col.rows % 2 == 1);
+    CV_Assert(row.type() == CV_32FC1 && row.rows == 1 && row.cols % 2 == 1);
+    cv::Mat ret_v = separable_border_filter2D(in, col, row, circular, nullptr);
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.size() == in.size());
+    return ret_v;
+}
+
+cv::Mat fsiv_border_usm(cv::Mat const &in, cv::Mat const &filter, bool circular,
+                        double g, cv::Mat *unsharp_mask)
+{
+    CV_Assert(in.type() == CV_32FC1 && filter.type() == CV_32FC1);
+    CV_Assert(filter.rows % 2 == 1 && filter.cols % 2 == 1);
+    CV_Assert(g >= 0.0);
+    if (unsharp_mask != nullptr)
+        unsharp_mask->create(in.size(), CV_32FC1);
+    const UsmEpilogue usm = {&in, float(1.0 + g), float(-g), unsharp_mask};
+    cv::Mat ret_v = border_filter2D(in, filter, circular, &usm);
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.size() == in.size());
+    return ret_v;
+}
+
+cv::Mat fsiv_usm_combine(cv::Mat const &in, cv::Mat const &blur, double g)
+{
+    CV_Assert(in.type() == CV_32FC1 && blur.type() == CV_32FC1);
+    CV_Assert(in.size() == blur.size());
+    CV_Assert(g >= 0.0);
+    cv::Mat ret_v(in.size(), CV_32FC1);
+    const UsmEpilogue usm = {&in, float(1.0 + g), float(-g), nullptr};
+    cv::parallel_for_(cv::Range(0, in.rows), [&](const cv::Range &range)
+    {
+        for (int y = range.start; y < range.end; ++y)
+            usm_epilogue_row(usm, y, 0, in.cols, blur.ptr<float>(y), ret_v.ptr<float>(y));
+    });
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.size() == in.size());
+    return ret_v;
+}
+
+void fsiv_set_virtual_borders(bool enable)
+{
+    virtual_borders = enable;
+}
+
+bool fsiv_get_virtual_borders()
+{
+    return virtual_borders;
+}
+
+void fsiv_set_tiled_convolution(bool enable)
+{
+    tiled_convolution = enable;
+}
+
+bool fsiv_get_tiled_convolution()
+{
+    return tiled_convolution;
+}
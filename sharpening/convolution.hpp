@@ -0,0 +1,186 @@
+/**
+ * @file convolution.hpp
+ * @brief Fast paths to compute the digital correlation of an image.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#pragma once
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Split a filter as the product of a column and a row filter.
+ *
+ * A filter is separable if it has rank one, that is filter = col * row. The
+ * column and row are taken from the largest magnitude coefficient and the
+ * product is checked against the filter.
+ *
+ * @arg[in] filter is the filter to split.
+ * @arg[out] col is the column filter (filter.rows x 1).
+ * @arg[out] row is the row filter (1 x filter.cols).
+ * @arg[in] eps is the maximum difference allowed, relative to the largest coefficient.
+ * @return true if the filter is separable.
+ * @pre filter.type()==CV_32FC1
+ */
+bool fsiv_separate_filter(cv::Mat const &filter, cv::Mat &col, cv::Mat &row,
+                          double eps = 1.0e-6);
+
+/**
+ * @brief Compute the digital correlation with a dense filter.
+ *
+ * Reference spatial correlation, (filter.rows*filter.cols) multiply-adds per
+ * pixel. The output rows are computed in parallel.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] filter is the filter to be applied.
+ * @pre in.type()==CV_32FC1 && filter.type()==CV_32FC1.
+ * @post ret.type()==CV_32FC1
+ * @post ret.rows == in.rows-2*(filter.rows/2)
+ * @post ret.cols == in.cols-2*(filter.cols/2)
+ */
+cv::Mat fsiv_dense_filter2D(cv::Mat const &in, cv::Mat const &filter);
+
+/**
+ * @brief Compute the digital correlation with a dense filter by tiles.
+ *
+ * The output is split in tiles whose input area, with the filter halo, fits
+ * in the L2 cache. The tiles are processed in parallel and the inner loop is
+ * vectorized over four outputs. The result is the same as
+ * fsiv_dense_filter2D.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] filter is the filter to be applied.
+ * @pre in.type()==CV_32FC1 && filter.type()==CV_32FC1.
+ * @post ret.type()==CV_32FC1
+ * @post ret.rows == in.rows-2*(filter.rows/2)
+ * @post ret.cols == in.cols-2*(filter.cols/2)
+ */
+cv::Mat fsiv_tiled_filter2D(cv::Mat const &in, cv::Mat const &filter);
+
+/**
+ * @brief Compute the digital correlation with a separable filter.
+ *
+ * The filter is applied as two 1D passes. Each pass writes its result
+ * transposed, so both passes run along contiguous memory. The cost is
+ * (col.rows + row.cols) multiply-adds per pixel instead of col.rows*row.cols.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] col is the column filter.
+ * @arg[in] row is the row filter.
+ * @pre in.type()==CV_32FC1
+ * @pre col.type()==CV_32FC1 && col.cols==1
+ * @pre row.type()==CV_32FC1 && row.rows==1
+ * @post ret.type()==CV_32FC1
+ * @post ret.rows == in.rows-2*(col.rows/2)
+ * @post ret.cols == in.cols-2*(row.cols/2)
+ */
+cv::Mat fsiv_separable_filter2D(cv::Mat const &in, cv::Mat const &col,
+                                cv::Mat const &row);
+
+/**
+ * @brief Compute the digital correlation of an image extended with a virtual border.
+ *
+ * The result is the same as correlating the image expanded with
+ * fsiv_fill_expansion() (circular=false) or fsiv_circular_expansion()
+ * (circular=true) and keeping the valid area, but the expanded image is never
+ * built: the interior is filtered with unchecked accesses and only the border
+ * bands remap the indices. Separable filters are applied as two 1D passes.
+ * The products are added in the same order as in the expanded paths, so the
+ * output is bit-identical when the compiler does not fuse multiply-adds
+ * (-ffp-contract=off, see CMakeLists.txt).
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] filter is the filter to be applied.
+ * @arg[in] circular if the border wraps around instead of being zero.
+ * @pre in.type()==CV_32FC1 && filter.type()==CV_32FC1.
+ * @pre filter.rows and filter.cols are odd.
+ * @post ret.type()==CV_32FC1
+ * @post ret.size()==in.size()
+ */
+cv::Mat fsiv_border_filter2D(cv::Mat const &in, cv::Mat const &filter,
+                             bool circular);
+
+/**
+ * @brief Compute the digital correlation with a separable filter and a virtual border.
+ *
+ * The same as fsiv_border_filter2D(in, col*row, circular), but the two 1D
+ * passes are applied directly, without building and splitting the 2D filter.
+ * Both passes are done by tiles, keeping the row filtered values in a ring of
+ * col.rows rows, so the intermediate image is never stored.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] col is the column filter.
+ * @arg[in] row is the row filter.
+ * @arg[in] circular if the border wraps around instead of being zero.
+ * @pre in.type()==CV_32FC1
+ * @pre col.type()==CV_32FC1 && col.cols==1 && col.rows is odd
+ * @pre row.type()==CV_32FC1 && row.rows==1 && row.cols is odd
+ * @post ret.type()==CV_32FC1
+ * @post ret.size()==in.size()
+ */
+cv::Mat fsiv_separable_border_filter2D(cv::Mat const &in, cv::Mat const &col,
+                                       cv::Mat const &row, bool circular);
+
+/**
+ * @brief Enhance an image with unsharp masking using a virtual border.
+ *
+ * Computes (1+g)*in - g*blur, where blur is fsiv_border_filter2D(in, filter,
+ * circular), in the last filter pass, so the blurred image is not stored
+ * unless it is requested. The combination is done in float, so it can differ
+ * from fsiv_combine_images (double) in the last bit.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] filter is the blur filter.
+ * @arg[in] circular if the border wraps around instead of being zero.
+ * @arg[in] g is the enhance's gain.
+ * @arg[out] unsharp_mask if not nullptr, output the blurred image.
+ * @pre in.type()==CV_32FC1 && filter.type()==CV_32FC1.
+ * @pre filter.rows and filter.cols are odd.
+ * @pre g>=0.0
+ * @post ret.type()==CV_32FC1
+ * @post ret.size()==in.size()
+ */
+cv::Mat fsiv_border_usm(cv::Mat const &in, cv::Mat const &filter, bool circular,
+                        double g, cv::Mat *unsharp_mask = nullptr);
+
+/**
+ * @brief Enhance an image with unsharp masking given its blurred image.
+ *
+ * Computes (1+g)*in - g*blur in float with the same expression as the last
+ * pass of fsiv_border_usm and fsiv_box_usm, so the enhanced image does not
+ * depend on how the blurred image was obtained.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] blur is the blurred image.
+ * @arg[in] g is the enhance's gain.
+ * @pre in.type()==CV_32FC1 && blur.type()==CV_32FC1
+ * @pre in.size()==blur.size()
+ * @pre g>=0.0
+ * @post ret.type()==CV_32FC1
+ * @post ret.size()==in.size()
+ */
+cv::Mat fsiv_usm_combine(cv::Mat const &in, cv::Mat const &blur, double g);
+
+/**
+ * @brief Enable the virtual border path (fsiv_border_filter2D).
+ * @arg[in] enable if false, the image is expanded before filtering.
+ */
+void fsiv_set_virtual_borders(bool enable);
+
+/**
+ * @brief Get if the virtual border path is enabled (default true).
+ */
+bool fsiv_get_virtual_borders();
+
+/**
+ * @brief Enable the tiled correlation (fsiv_tiled_filter2D) for dense filters.
+ * @arg[in] enable if false, dense filters are correlated row by row.
+ */
+void fsiv_set_tiled_convolution(bool enable);
+
+/**
+ * @brief Get if the tiled correlation is enabled (default true).
+ */
+bool fsiv_get_tiled_convolution();
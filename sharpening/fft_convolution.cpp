@@ -0,0 +1,182 @@
+/**
+ * @file fft_convolution.cpp
+ * @brief Digital correlation computed in the frequency domain.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include "fft_convolution.hpp"
+#include <cmath>
+#include <deque>
+#include <mutex>
+
+// Cost of a P*log2(P) unit of the DFT correlation in multiply-adds.
+static double fft_cost_ratio = 2.0;
+
+// Maximum number of filter spectra kept.
+static const size_t SPECTRUM_CACHE_SIZE = 8;
+
+typedef struct
+{
+    cv::Mat filter;
+    cv::Size dft_size;
+    bool circular;
+    cv::Mat spectrum;
+} CachedSpectrum;
+
+static std::mutex spectrum_cache_mutex;
+static std::deque<CachedSpectrum> spectrum_cache;
+
+/**
+ * @brief Place a filter centred on the origin of a periodic image.
+ *
+ * Coefficient (i,j) goes to ((i-r) mod rows, (j-c) mod cols), accumulating
+ * the coefficients that fall on the same cell when the filter is larger than
+ * the period, as the wrapped border extension does.
+ *
+ * @param filter is the filter.
+ * @param dft_size is the period.
+ * @return the wrapped filter (CV_32FC1).
+ */
+static cv::Mat wrap_filter(const cv::Mat &filter, const cv::Size &dft_size)
+{
+    cv::Mat wrapped = cv::Mat::zeros(dft_size, CV_32FC1);
+    const int r = filter.rows / 2;
+    const int c = filter.cols / 2;
+    for (int i = 0; i < filter.rows; ++i)
+    {
+        const int y = ((i - r) % dft_size.height + dft_size.height) % dft_size.height;
+        const float *f = filter.ptr<float>(i);
+        float *w = wrapped.ptr<float>(y);
+        for (int j = 0; j < filter.cols; ++j)
+            w[((j - c) % dft_size.width + dft_size.width) % dft_size.width] += f[j];
+    }
+    return wrapped;
+}
+
+/**
+ * @brief Get the spectrum of a filter padded to a DFT size.
+ * @param filter is the filter.
+ * @param dft_size is the DFT size.
+ * @param circular if the filter is centred on the origin (see wrap_filter)
+ *                 instead of being zero padded at the top-left corner.
+ * @return the complex spectrum (CV_32FC2).
+ */
+static cv::Mat filter_spectrum(const cv::Mat &filter, const cv::Size &dft_size,
+                               bool circular)
+{
+    std::lock_guard<std::mutex> lock(spectrum_cache_mutex);
+    for (size_t i = 0; i < spectrum_cache.size(); ++i)
+    {
+        const CachedSpectrum &e = spectrum_cache[i];
+        if (e.dft_size == dft_size && e.circular == circular &&
+            e.filter.size() == filter.size() &&
+            cv::norm(e.filter, filter, cv::NORM_INF) == 0.0)
+        {
+            // Move to the front so the least recently used is dropped first.
+            const CachedSpectrum found = e;
+            spectrum_cache.erase(spectrum_cache.begin() + i);
+            spectrum_cache.push_front(found);
+            return found.spectrum;
+        }
+    }
+
+    CachedSpectrum e;
+    e.filter = filter.clone();
+    e.dft_size = dft_size;
+    e.circular = circular;
+    if (circular)
+        cv::dft(wrap_filter(filter, dft_size), e.spectrum, cv::DFT_COMPLEX_OUTPUT);
+    else
+    {
+        cv::Mat padded;
+        cv::copyMakeBorder(filter, padded, 0, dft_size.height - filter.rows,
+                           0, dft_size.width - filter.cols, cv::BORDER_CONSTANT, cv::Scalar(0.0));
+        cv::dft(padded, e.spectrum, cv::DFT_COMPLEX_OUTPUT, filter.rows);
+    }
+    spectrum_cache.push_front(e);
+    if (spectrum_cache.size() > SPECTRUM_CACHE_SIZE)
+        spectrum_cache.pop_back();
+    return e.spectrum;
+}
+
+cv::Mat
+fsiv_fft_filter2D(cv::Mat const &in, cv::Mat const &filter)
+{
+    CV_Assert(!in.empty() && !filter.empty());
+    CV_Assert(in.type() == CV_32FC1 && filter.type() == CV_32FC1);
+    CV_Assert(in.rows >= filter.rows && in.cols >= filter.cols);
+
+    // A circular correlation of size >= in.size() does not wrap around on
+    // the valid output area, so no extra padding is needed.
+    const cv::Size dft_size(cv::getOptimalDFTSize(in.cols), cv::getOptimalDFTSize(in.rows));
+    cv::Mat padded;
+    cv::copyMakeBorder(in, padded, 0, dft_size.height - in.rows,
+                       0, dft_size.width - in.cols, cv::BORDER_CONSTANT, cv::Scalar(0.0));
+    cv::Mat spectrum;
+    cv::dft(padded, spectrum, cv::DFT_COMPLEX_OUTPUT, in.rows);
+    // Correlation is the product with the conjugated filter spectrum.
+    cv::mulSpectrums(spectrum, filter_spectrum(filter, dft_size, false), spectrum, 0, true);
+    cv::Mat corr;
+    cv::idft(spectrum, corr, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+
+    cv::Mat ret_v = corr(cv::Rect(0, 0, in.cols - 2 * (filter.cols / 2),
+                                  in.rows - 2 * (filter.rows / 2))).clone();
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.rows == in.rows - 2 * (filter.rows / 2));
+    CV_Assert(ret_v.cols == in.cols - 2 * (filter.cols / 2));
+    return ret_v;
+}
+
+cv::Mat
+fsiv_fft_circular_filter2D(cv::Mat const &in, cv::Mat const &filter)
+{
+    CV_Assert(!in.empty() && !filter.empty());
+    CV_Assert(in.type() == CV_32FC1 && filter.type() == CV_32FC1);
+
+    // The DFT of the image itself is periodic, so no expansion is needed.
+    cv::Mat spectrum;
+    cv::dft(in, spectrum, cv::DFT_COMPLEX_OUTPUT);
+    cv::mulSpectrums(spectrum, filter_spectrum(filter, in.size(), true), spectrum, 0, true);
+    cv::Mat ret_v;
+    cv::idft(spectrum, ret_v, cv::DFT_SCALE | cv::DFT_REAL_OUTPUT);
+
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.size() == in.size());
+    return ret_v;
+}
+
+bool fsiv_fft_is_faster(const cv::Size &image_size, const cv::Size &filter_size,
+                        bool separable, bool circular)
+{
+    // The circular correlation runs the DFT at the image size, which can not
+    // be padded. Sizes with large prime factors are much slower than the
+    // model predicts, so only the optimal sizes use the DFT.
+    if (circular && (cv::getOptimalDFTSize(image_size.width) != image_size.width ||
+                     cv::getOptimalDFTSize(image_size.height) != image_size.height))
+        return false;
+    const double out_area = circular
+                                ? double(image_size.width) * image_size.height
+                                : double(image_size.width - 2 * (filter_size.width / 2)) *
+                                      (image_size.height - 2 * (filter_size.height / 2));
+    const double macs = separable ? filter_size.width + filter_size.height
+                                  : double(filter_size.width) * filter_size.height;
+    const double p = circular
+                         ? double(image_size.width) * image_size.height
+                         : double(cv::getOptimalDFTSize(image_size.width)) *
+                               cv::getOptimalDFTSize(image_size.height);
+    return fft_cost_ratio * p * std::log2(p) < out_area * macs;
+}
+
+void fsiv_set_fft_cost_ratio(double ratio)
+{
+    CV_Assert(ratio > 0.0);
+    fft_cost_ratio = ratio;
+}
+
+double fsiv_get_fft_cost_ratio()
+{
+    return fft_cost_ratio;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file fft_convolution.hpp
+ * @brief Digital correlation computed in the frequency domain.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#pragma once
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Compute the digital correlation between an image and a filter using the DFT.
+ *
+ * The image is zero padded to an optimal DFT size and multiplied by the
+ * conjugated filter spectrum. The filter spectra are cached, so applying the
+ * same filter to images of the same size only computes two DFTs.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] filter is the filter to be applied.
+ * @pre !in.empty() && !filter.empty()
+ * @pre in.type()==CV_32FC1 && filter.type()==CV_32FC1.
+ * @pre in.rows>=filter.rows && in.cols>=filter.cols
+ * @post ret.type()==CV_32FC1
+ * @post ret.rows == in.rows-2*(filter.rows/2)
+ * @post ret.cols == in.cols-2*(filter.cols/2)
+ */
+cv::Mat fsiv_fft_filter2D(cv::Mat const &in, cv::Mat const &filter);
+
+/**
+ * @brief Compute the circular correlation between an image and a filter using the DFT.
+ *
+ * The result is the same as correlating the image expanded with
+ * fsiv_circular_expansion() and keeping the valid area, but the expanded image
+ * is never built: the filter is centred on the origin of a DFT of the same size
+ * as the image. The filter spectra are cached as in fsiv_fft_filter2D().
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] filter is the filter to be applied.
+ * @pre !in.empty() && !filter.empty()
+ * @pre in.type()==CV_32FC1 && filter.type()==CV_32FC1.
+ * @post ret.type()==CV_32FC1
+ * @post ret.size()==in.size()
+ */
+cv::Mat fsiv_fft_circular_filter2D(cv::Mat const &in, cv::Mat const &filter);
+
+/**
+ * @brief Decide if the DFT correlation is faster than the spatial one.
+ *
+ * The spatial cost is the number of multiply-adds. The DFT cost is
+ * ratio*P*log2(P) with P the area of the padded image, where ratio is the
+ * value set by fsiv_set_fft_cost_ratio(). A circular correlation is only done
+ * with the DFT when the image size is an optimal DFT size
+ * (cv::getOptimalDFTSize), because it can not be padded.
+ *
+ * @arg[in] image_size is the size of the (expanded) input image, or the size
+ *          of the non expanded image for a circular correlation.
+ * @arg[in] filter_size is the filter size.
+ * @arg[in] separable if the spatial correlation is done with two 1D passes.
+ * @arg[in] circular if the DFT correlation is fsiv_fft_circular_filter2D().
+ * @return true if the DFT correlation should be used.
+ */
+bool fsiv_fft_is_faster(const cv::Size &image_size, const cv::Size &filter_size,
+                        bool separable = false, bool circular = false);
+
+/**
+ * @brief Set the relative cost of the DFT correlation.
+ * @arg[in] ratio is the cost of a P*log2(P) unit in multiply-adds. Use the
+ *          value measured by the program bench_convolution.
+ * @pre ratio>0.0
+ */
+void fsiv_set_fft_cost_ratio(double ratio);
+
+/**
+ * @brief Get the relative cost of the DFT correlation.
+ */
+double fsiv_get_fft_cost_ratio();
@@ -0,0 +1,144 @@
+/**
+ * @file laplacian_stencil.cpp
+ * @brief Sharpening with the 3x3 Laplacian filters as add/sub stencils.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include "laplacian_stencil.hpp"
+#include <vector>
+#include <opencv2/core/utility.hpp>
+
+/**
+ * @brief Arithmetic type used to compute a pixel type.
+ */
+template <typename T>
+struct StencilWork
+{
+    typedef float type;
+};
+
+template <>
+struct StencilWork<uchar>
+{
+    typedef int type;
+};
+
+/**
+ * @brief The sharpening stencil of a Laplacian filter.
+ *
+ * The terms are added in the filter's row major order, so for float images
+ * the rounding is the same as the generic correlation.
+ */
+template <int FILTER_TYPE, typename W>
+struct SharpeningStencil;
+
+// [1]-LAP_4 = [0 -1 0; -1 5 -1; 0 -1 0]
+template <typename W>
+struct SharpeningStencil<0, W>
+{
+    static inline W apply(W, W u, W, W l, W c, W r, W, W d, W)
+    {
+        return -u - l + W(5) * c - r - d;
+    }
+};
+
+// [1]-LAP_8 = [-1 -1 -1; -1 9 -1; -1 -1 -1]
+template <typename W>
+struct SharpeningStencil<1, W>
+{
+    static inline W apply(W ul, W u, W ur, W l, W c, W r, W dl, W d, W dr)
+    {
+        return -ul - u - ur - l + W(9) * c - r - dl - d - dr;
+    }
+};
+
+/**
+ * @brief Map an index of the expanded image to the source image.
+ * @return the source index, or -1 for a zero border.
+ */
+static inline int border_index(int i, int n, bool circular)
+{
+    if (i >= 0 && i < n)
+        return i;
+    if (!circular)
+        return -1;
+    i %= n;
+    return i < 0 ? i + n : i;
+}
+
+/**
+ * @brief Sharpen an image with a Laplacian stencil.
+ * @param in is the input image.
+ * @param out is the output image (same size and type).
+ * @param circular if the border wraps around instead of being zero.
+ */
+template <int FILTER_TYPE, typename T>
+static void sharpen(const cv::Mat &in, cv::Mat &out, bool circular)
+{
+    typedef typename StencilWork<T>::type W;
+    typedef SharpeningStencil<FILTER_TYPE, W> S;
+    const int cols = in.cols;
+    const std::vector<T> zeros(cols, T(0));
+    cv::parallel_for_(cv::Range(0, in.rows), [&](const cv::Range &range)
+    {
+        for (int y = range.start; y < range.end; ++y)
+        {
+            const int yu = border_index(y - 1, in.rows, circular);
+            const int yd = border_index(y + 1, in.rows, circular);
+            const T *pu = yu < 0 ? zeros.data() : in.ptr<T>(yu);
+            const T *pc = in.ptr<T>(y);
+            const T *pd = yd < 0 ? zeros.data() : in.ptr<T>(yd);
+            T *dst = out.ptr<T>(y);
+
+            // Interior columns: no index checks.
+            for (int x = 1; x < cols - 1; ++x)
+                dst[x] = cv::saturate_cast<T>(S::apply(
+                    W(pu[x - 1]), W(pu[x]), W(pu[x + 1]),
+                    W(pc[x - 1]), W(pc[x]), W(pc[x + 1]),
+                    W(pd[x - 1]), W(pd[x]), W(pd[x + 1])));
+
+            // First and last columns remap the neighbors.
+            for (int x = 0; x < cols; x = (x == 0 && cols > 1) ? cols - 1 : cols)
+            {
+                const int xl = border_index(x - 1, cols, circular);
+                const int xr = border_index(x + 1, cols, circular);
+                const W ul = xl < 0 ? W(0) : W(pu[xl]);
+                const W l = xl < 0 ? W(0) : W(pc[xl]);
+                const W dl = xl < 0 ? W(0) : W(pd[xl]);
+                const W ur = xr < 0 ? W(0) : W(pu[xr]);
+                const W r = xr < 0 ? W(0) : W(pc[xr]);
+                const W dr = xr < 0 ? W(0) : W(pd[xr]);
+                dst[x] = cv::saturate_cast<T>(S::apply(ul, W(pu[x]), ur, l, W(pc[x]), r,
+                                                       dl, W(pd[x]), dr));
+            }
+        }
+    });
+}
+
+cv::Mat
+fsiv_laplacian_sharpening(const cv::Mat &in, int filter_type, bool circular)
+{
+    CV_Assert(in.type() == CV_32FC1 || in.type() == CV_8UC1);
+    CV_Assert(filter_type == 0 || filter_type == 1);
+    cv::Mat out(in.size(), in.type());
+    if (in.type() == CV_32FC1)
+    {
+        if (filter_type == 0)
+            sharpen<0, float>(in, out, circular);
+        else
+            sharpen<1, float>(in, out, circular);
+    }
+    else
+    {
+        if (filter_type == 0)
+            sharpen<0, uchar>(in, out, circular);
+        else
+            sharpen<1, uchar>(in, out, circular);
+    }
+    CV_Assert(out.type() == in.type());
+    CV_Assert(out.size() == in.size());
+    return out;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file laplacian_stencil.hpp
+ * @brief Sharpening with the 3x3 Laplacian filters as add/sub stencils.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#pragma once
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Do a sharpening enhance with a 3x3 Laplacian filter.
+ *
+ * The sharpening filter [1]-LAP_4 (5*center minus the four neighbors) or
+ * [1]-LAP_8 (9*center minus the eight neighbors) is computed with adds and
+ * subtracts, specialized at compile time for the filter and the pixel type,
+ * and without building an expanded image. The result is the same as
+ * fsiv_image_sharpening(in, filter_type, r1, r2, circular) for float images.
+ * 8-bit images are computed with integers and saturated.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] filter_type is 0->LAP_4 or 1->LAP_8.
+ * @arg[in] circular if it is true, use circular convolution, else zero padding.
+ * @return the enhanced image.
+ * @pre in.type()==CV_32FC1 || in.type()==CV_8UC1
+ * @pre filter_type in {0,1}
+ * @post ret.type()==in.type()
+ * @post ret.size()==in.size()
+ */
+cv::Mat fsiv_laplacian_sharpening(const cv::Mat &in, int filter_type,
+                                  bool circular);
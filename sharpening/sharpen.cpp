@@ -22,20 +22,23 @@
 // #include <opencv2/calib3d/calib3d.hpp>
 
 #include "common_code.hpp"
+#include "fft_convolution.hpp"
 
 const char *keys =
     "{help h usage ? |      | print this message.}"
     "{i interactive  |      | Activate interactive mode.}"
-    "{f filter       |0     | Laplacian filter to be used to build the sharpening filter: 0->LAP_4, 1->LAP_8, 2->DOG}"
+    "{f filter       |0     | Laplacian filter to be used to build the sharpening filter: 0->LAP_4, 1->LAP_8, 2->DOG, 3->DOG with recursive Gaussians, 4->DOG with cascaded Gaussians}"
     "{r1             |1     | r1 for DoG filter.}"
     "{r2             |2     | r2 for DoG filter. (0<r1<r2)}"
     "{c circular     |      | use circular convolution.}"
+    "{fft_ratio      |2.0   | cost of the DFT correlation relative to the spatial one.}"
     "{@input         |<none>| input image.}"
     "{@output        |<none>| output image.}";
 
 struct UserData
 {
     cv::Mat input;
+    cv::Mat input_u8; // 8-bit gray input, if any.
     std::vector<cv::Mat> input_channels;
     std::vector<cv::Mat> output_channels;
     cv::Mat output;
@@ -53,11 +56,22 @@ void do_the_work(UserData *user_data)
     if (user_data->input_channels.size() == 3)
         input = user_data->input_channels[2];
 
-    user_data->output = fsiv_image_sharpening(input,
-                                              user_data->filter_type,
-                                              user_data->r1,
-                                              user_data->r2,
-                                              user_data->circular);
+    if (!user_data->input_u8.empty() && user_data->filter_type <= 1)
+    {
+        // The Laplacian filters sharpen 8-bit images with integers.
+        cv::Mat output_u8 = fsiv_image_sharpening(user_data->input_u8,
+                                                  user_data->filter_type,
+                                                  user_data->r1,
+                                                  user_data->r2,
+                                                  user_data->circular);
+        output_u8.convertTo(user_data->output, CV_32F, 1.0 / 255.0);
+    }
+    else
+        user_data->output = fsiv_image_sharpening(input,
+                                                  user_data->filter_type,
+                                                  user_data->r1,
+                                                  user_data->r2,
+                                                  user_data->circular);
 
     if (user_data->input_channels.size() == 3)
     {
@@ -74,7 +88,7 @@ void do_the_work(UserData *user_data)
 void filter_trackbar(int pos, void *userdata)
 {
     UserData *d = static_cast<UserData *>(userdata);
-    pos = std::max(0, std::min(pos, 2));
+    pos = std::max(0, std::min(pos, 4));
     d->filter_type = pos;
     std::cout << "Set filter type to " << d->filter_type << std::endl;
     do_the_work(d);
@@ -147,6 +161,8 @@ int main(int argc, char *const *argv)
             return EXIT_FAILURE;
         }
 
+        if (data.input.type() == CV_8UC1)
+            data.input_u8 = data.input;
         data.input.convertTo(data.input, CV_32F, 1.0 / 255.0);
 
         if (data.input.channels() == 3)
@@ -157,9 +173,9 @@ int main(int argc, char *const *argv)
             data.output_channels = data.input_channels;
         }
 
-        if (data.filter_type < 0 || data.filter_type > 2)
+        if (data.filter_type < 0 || data.filter_type > 4)
         {
-            std::cerr << "Error: filter type parameter has values in {0, 1, 2}." << std::endl;
+            std::cerr << "Error: filter type parameter has values in {0, 1, 2, 3, 4}." << std::endl;
             return EXIT_FAILURE;
         }
 
@@ -168,6 +184,14 @@ int main(int argc, char *const *argv)
             std::cerr << "Error: Condition 0 < r1 < r2 is not meet." << std::endl;
             return EXIT_FAILURE;
         }
+
+        const double fft_ratio = parser.get<double>("fft_ratio");
+        if (fft_ratio <= 0.0)
+        {
+            std::cerr << "Error: fft_ratio must be > 0." << std::endl;
+            return EXIT_FAILURE;
+        }
+        fsiv_set_fft_cost_ratio(fft_ratio);
         int key = 0;
 
         if (data.interactive)
@@ -175,7 +199,7 @@ int main(int argc, char *const *argv)
             cv::namedWindow("INPUT");
             cv::namedWindow("OUTPUT");
             cv::imshow("INPUT", data.input);
-            cv::createTrackbar("FILTER", "OUTPUT", 0, 2, filter_trackbar, &data);
+            cv::createTrackbar("FILTER", "OUTPUT", 0, 4, filter_trackbar, &data);
             cv::setTrackbarPos("FILTER", "OUTPUT", data.filter_type);
             cv::createTrackbar("R1", "OUTPUT", 0, std::min(data.input.rows, data.input.cols) / 2, r1_trackbar, &data);
             cv::setTrackbarPos("R1", "OUTPUT", data.r2);
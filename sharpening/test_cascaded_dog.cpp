@@ -0,0 +1,240 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <exception>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "cascaded_dog.hpp"
+#include "convolution.hpp"
+
+/**
+ * @brief Create the 2D Gaussian filter of a radius.
+ * @param r is the radius.
+ * @return the (2r+1)x(2r+1) filter.
+ */
+static cv::Mat my_gaussian_filter(int r)
+{
+    const cv::Mat k = cv::getGaussianKernel(2 * r + 1, -1, CV_32F);
+    return k * k.t();
+}
+
+/**
+ * @brief Create the DoG filter G(r2) - G(r1) as a single filter.
+ * @param r1 is the radius of the first Gaussian filter.
+ * @param r2 is the radius of the second Gaussian filter.
+ * @return the (2r2+1)x(2r2+1) filter.
+ */
+static cv::Mat my_dog_filter(int r1, int r2)
+{
+    cv::Mat g1;
+    cv::copyMakeBorder(my_gaussian_filter(r1), g1, r2 - r1, r2 - r1, r2 - r1, r2 - r1,
+                       cv::BORDER_CONSTANT, cv::Scalar(0));
+    return my_gaussian_filter(r2) - g1;
+}
+
+/**
+ * @brief Get the documented error bound of a level of the Gaussian scale stack.
+ * @param r is the radius of the level.
+ * @return the maximum absolute difference for images of noise in [0, 1].
+ */
+static double my_tolerance(int r)
+{
+    if (r <= 3)
+        return 0.02;
+    if (r == 4)
+        return 0.01;
+    if (r == 5)
+        return 0.008;
+    if (r <= 7)
+        return 0.006;
+    if (r <= 15)
+        return 0.005;
+    return 0.004;
+}
+
+/**
+ * @brief Compare two images and save the test data if they differ more than a tolerance.
+ * @param label is the test label.
+ * @param in is the input image.
+ * @param filter is the reference filter.
+ * @param my_out is the reference output.
+ * @param your_out is the tested output.
+ * @param tolerance is the maximum allowed absolute difference.
+ * @param tests is the test counter.
+ * @param seed is the random seed, used to name the data file of a fail.
+ * @return true if the test passes.
+ */
+static bool check(const std::string &label, const cv::Mat &in, const cv::Mat &filter,
+                  const cv::Mat &my_out, const cv::Mat &your_out,
+                  double tolerance, int tests, cv::uint64_t seed)
+{
+    std::cout << label << " ... ";
+    const double norm_v = (my_out.size() == your_out.size())
+                              ? cv::norm(my_out, your_out, cv::NORM_INF)
+                              : -1.0;
+    if (norm_v >= 0.0 && norm_v <= tolerance)
+    {
+        std::cout << " Ok!" << std::endl;
+        return true;
+    }
+    std::ostringstream fname;
+    fname << "test-" << tests << '-' << seed << ".xml";
+    std::cerr << "Test fail: cv::norm(my_out, your_out, cv::NORM_INF)=" << norm_v
+              << " (should be <= " << tolerance << "!)" << std::endl;
+    std::cerr << "\t test data file: " << fname.str() << std::endl;
+    auto file = cv::FileStorage();
+    file.open(fname.str(), cv::FileStorage::WRITE);
+    file << "Linf" << norm_v;
+    file << "in" << in;
+    file << "filter" << filter;
+    file << "my_out" << my_out;
+    file << "your_out" << your_out;
+    file.release();
+    return false;
+}
+
+int main(int argc, char *const *argv)
+{
+    int retCode = EXIT_SUCCESS;
+    int tests_passed = 0;
+    int tests = 0;
+    cv::uint64_t seed = 0;
+    if (argc > 1)
+        seed = static_cast<cv::uint64_t>(std::atoll(argv[1]));
+    else
+        seed = cv::getTickCount();
+    std::cerr << "Random seed: " << seed << std::endl;
+    cv::RNG rng(seed);
+
+    // Image sizes (rows, cols). With zero padding the levels are computed on
+    // an image padded with the cascade's radius, which can be larger than the
+    // image.
+    const int sizes[][2] = {{64, 80}, {9, 120}};
+    // Radii (r1, r2) of fsiv_cascaded_dog.
+    const int pairs[][2] = {{1, 2}, {1, 3}, {2, 3}, {3, 4}, {1, 5},
+                            {4, 5}, {2, 7}, {3, 8}, {5, 16}};
+    // Radii of the scale stacks.
+    const std::vector<std::vector<int>> stacks = {{1, 2, 3, 5, 8, 16},
+                                                  {2, 4, 8, 16, 32}};
+
+    try
+    {
+        for (const auto &s : sizes)
+            for (int circular = 0; circular < 2; ++circular)
+            {
+                cv::Mat in(s[0], s[1], CV_32FC1);
+                rng.fill(in, cv::RNG::UNIFORM, 0, 256);
+                in.convertTo(in, CV_32F, 1.0 / 255.0);
+
+                // The r1 blur is exact, so the DoG has the error of the r2 level.
+                for (const auto &p : pairs)
+                {
+                    try
+                    {
+                        tests++;
+                        std::ostringstream label;
+                        label << "fsiv_cascaded_dog (" << s[0] << "x" << s[1] << ", r1=" << p[0]
+                              << " r2=" << p[1] << (circular ? ", circular" : ", zero") << ")";
+                        const cv::Mat filter = my_dog_filter(p[0], p[1]);
+                        const cv::Mat my_out = fsiv_border_filter2D(in, filter, circular != 0);
+                        const cv::Mat your_out = fsiv_cascaded_dog(in, p[0], p[1], circular != 0);
+                        if (check(label.str(), in, filter, my_out, your_out,
+                                  my_tolerance(p[1]), tests, seed))
+                            tests_passed++;
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "Error: unknown exception!!." << std::endl;
+                    }
+                }
+
+                for (const auto &radii : stacks)
+                {
+                    // Each level against the Gaussian filter of its radius.
+                    try
+                    {
+                        tests++;
+                        const std::vector<cv::Mat> your_levels =
+                            fsiv_gaussian_scale_stack(in, radii, circular != 0);
+                        bool ok = your_levels.size() == radii.size();
+                        for (size_t i = 0; ok && i < radii.size(); ++i)
+                        {
+                            std::ostringstream label;
+                            label << "fsiv_gaussian_scale_stack (" << s[0] << "x" << s[1]
+                                  << ", level " << i << " r=" << radii[i]
+                                  << (circular ? ", circular" : ", zero") << ")";
+                            const cv::Mat filter = my_gaussian_filter(radii[i]);
+                            const cv::Mat my_out = fsiv_border_filter2D(in, filter, circular != 0);
+                            ok = check(label.str(), in, filter, my_out, your_levels[i],
+                                       i == 0 ? 1.0e-6 : my_tolerance(radii[i]), tests, seed);
+                        }
+                        if (ok)
+                            tests_passed++;
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "Error: unknown exception!!." << std::endl;
+                    }
+
+                    // Each DoG against the single DoG filter.
+                    try
+                    {
+                        tests++;
+                        const std::vector<cv::Mat> your_dogs =
+                            fsiv_dog_scale_stack(in, radii, circular != 0);
+                        bool ok = your_dogs.size() == radii.size() - 1;
+                        for (size_t i = 0; ok && i + 1 < radii.size(); ++i)
+                        {
+                            std::ostringstream label;
+                            label << "fsiv_dog_scale_stack (" << s[0] << "x" << s[1]
+                                  << ", r1=" << radii[i] << " r2=" << radii[i + 1]
+                                  << (circular ? ", circular" : ", zero") << ")";
+                            const cv::Mat filter = my_dog_filter(radii[i], radii[i + 1]);
+                            const cv::Mat my_out = fsiv_border_filter2D(in, filter, circular != 0);
+                            const double tolerance = (i == 0 ? 0.0 : my_tolerance(radii[i])) +
+                                                     my_tolerance(radii[i + 1]);
+                            ok = check(label.str(), in, filter, my_out, your_dogs[i],
+                                       tolerance, tests, seed);
+                        }
+                        if (ok)
+                            tests_passed++;
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "Error: unknown exception!!." << std::endl;
+                    }
+                }
+            }
+
+        std::cout << "You pass " << tests_passed << " of " << tests << " tests." << std::endl;
+        if (tests_passed != tests)
+            retCode = EXIT_FAILURE;
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    catch (...)
+    {
+        std::cerr << "Error: unknown exception!!." << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    return retCode;
+}
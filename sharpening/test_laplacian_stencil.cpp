@@ -0,0 +1,163 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <exception>
+
+#include <opencv2/core/core.hpp>
+
+#include "convolution.hpp"
+#include "laplacian_stencil.hpp"
+
+/**
+ * @brief Create the sharpening filter [1]-LAP of a Laplacian filter.
+ * @param filter_type is 0->LAP_4 or 1->LAP_8.
+ * @return the 3x3 sharpening filter.
+ */
+static cv::Mat my_sharpening_filter(int filter_type)
+{
+    static const float lap4[] = {0.0f, -1.0f, 0.0f,
+                                 -1.0f, 5.0f, -1.0f,
+                                 0.0f, -1.0f, 0.0f};
+    static const float lap8[] = {-1.0f, -1.0f, -1.0f,
+                                 -1.0f, 9.0f, -1.0f,
+                                 -1.0f, -1.0f, -1.0f};
+    return cv::Mat(3, 3, CV_32FC1, const_cast<float *>(filter_type == 0 ? lap4 : lap8)).clone();
+}
+
+/**
+ * @brief Compare two images and save the test data if they differ more than a tolerance.
+ * @param label is the test label.
+ * @param in is the input image.
+ * @param filter is the filter.
+ * @param my_out is the reference output.
+ * @param your_out is the tested output.
+ * @param tolerance is the maximum allowed absolute difference.
+ * @param tests is the test counter.
+ * @param seed is the random seed, used to name the data file of a fail.
+ * @return true if the test passes.
+ */
+static bool check(const std::string &label, const cv::Mat &in, const cv::Mat &filter,
+                  const cv::Mat &my_out, const cv::Mat &your_out,
+                  double tolerance, int tests, cv::uint64_t seed)
+{
+    std::cout << label << " ... ";
+    const double norm_v = (my_out.size() == your_out.size() && my_out.type() == your_out.type())
+                              ? cv::norm(my_out, your_out, cv::NORM_INF)
+                              : -1.0;
+    if (norm_v >= 0.0 && norm_v <= tolerance)
+    {
+        std::cout << " Ok!" << std::endl;
+        return true;
+    }
+    std::ostringstream fname;
+    fname << "test-" << tests << '-' << seed << ".xml";
+    std::cerr << "Test fail: cv::norm(my_out, your_out, cv::NORM_INF)=" << norm_v
+              << " (should be <= " << tolerance << "!)" << std::endl;
+    std::cerr << "\t test data file: " << fname.str() << std::endl;
+    auto file = cv::FileStorage();
+    file.open(fname.str(), cv::FileStorage::WRITE);
+    file << "Linf" << norm_v;
+    file << "in" << in;
+    file << "filter" << filter;
+    file << "my_out" << my_out;
+    file << "your_out" << your_out;
+    file.release();
+    return false;
+}
+
+int main(int argc, char *const *argv)
+{
+    int retCode = EXIT_SUCCESS;
+    int tests_passed = 0;
+    int tests = 0;
+    cv::uint64_t seed = 0;
+    if (argc > 1)
+        seed = static_cast<cv::uint64_t>(std::atoll(argv[1]));
+    else
+        seed = cv::getTickCount();
+    std::cerr << "Random seed: " << seed << std::endl;
+    cv::RNG rng(seed);
+
+    // Image sizes (rows, cols): odd sizes, a single row or column, where the
+    // first and last columns are the same pixel, and images thinner than the
+    // stencil.
+    const int cases[][2] = {{37, 53}, {64, 64}, {1, 40}, {40, 1}, {1, 1},
+                            {2, 2}, {3, 70}, {70, 3}};
+    const char *filter_names[] = {"LAP_4", "LAP_8"};
+
+    try
+    {
+        for (const auto &c : cases)
+            for (int f = 0; f < 2; ++f)
+                for (int circular = 0; circular < 2; ++circular)
+                {
+                    const cv::Mat filter = my_sharpening_filter(f);
+                    std::ostringstream params;
+                    params << "(" << c[0] << "x" << c[1] << ", " << filter_names[f]
+                           << (circular ? ", circular" : ", zero") << ")";
+
+                    // The stencil adds the terms in the filter's order, so a
+                    // float image is the same as the generic correlation.
+                    try
+                    {
+                        tests++;
+                        cv::Mat in(c[0], c[1], CV_32FC1);
+                        rng.fill(in, cv::RNG::UNIFORM, 0, 256);
+                        in.convertTo(in, CV_32F, 1.0 / 255.0);
+                        const cv::Mat my_out = fsiv_border_filter2D(in, filter, circular != 0);
+                        const cv::Mat your_out = fsiv_laplacian_sharpening(in, f, circular != 0);
+                        if (check("fsiv_laplacian_sharpening CV_32F " + params.str(),
+                                  in, filter, my_out, your_out, 0.0, tests, seed))
+                            tests_passed++;
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "Error: unknown exception!!." << std::endl;
+                    }
+
+                    // 8-bit images are computed with integers, so they must be
+                    // the float result saturated.
+                    try
+                    {
+                        tests++;
+                        cv::Mat in(c[0], c[1], CV_8UC1);
+                        rng.fill(in, cv::RNG::UNIFORM, 0, 256);
+                        cv::Mat in_f, my_out;
+                        in.convertTo(in_f, CV_32F);
+                        fsiv_border_filter2D(in_f, filter, circular != 0).convertTo(my_out, CV_8U);
+                        const cv::Mat your_out = fsiv_laplacian_sharpening(in, f, circular != 0);
+                        if (check("fsiv_laplacian_sharpening CV_8U " + params.str(),
+                                  in, filter, my_out, your_out, 0.0, tests, seed))
+                            tests_passed++;
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "Error: unknown exception!!." << std::endl;
+                    }
+                }
+
+        std::cout << "You pass " << tests_passed << " of " << tests << " tests." << std::endl;
+        if (tests_passed != tests)
+            retCode = EXIT_FAILURE;
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    catch (...)
+    {
+        std::cerr << "Error: unknown exception!!." << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    return retCode;
+}
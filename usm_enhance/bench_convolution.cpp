@@ -0,0 +1,198 @@
+/**
+ * @file bench_convolution.cpp
+ * @brief Measure the spatial and DFT correlation to find the crossover.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include <iostream>
+#include <iomanip>
+#include <exception>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "convolution.hpp"
+#include "fft_convolution.hpp"
+
+const cv::String keys =
+    "{help h usage ? |      | print this message.}"
+    "{n repetitions  |3     | Number of times each correlation is measured.}"
+    "{m max_macs     |2e9   | Skip the spatial dense correlation above this number of multiply-adds.}"
+    "{s scaling      |      | Report the scaling of the tiled correlation with the number of threads.}";
+
+/**
+ * @brief Measure the mean time of a function.
+ * @param f is the function to measure.
+ * @param repetitions is the number of runs.
+ * @return the mean time in seconds.
+ */
+template <class F>
+double measure(F f, int repetitions)
+{
+    cv::TickMeter timer;
+    for (int i = 0; i < repetitions; ++i)
+    {
+        timer.start();
+        f();
+        timer.stop();
+    }
+    return timer.getTimeSec() / repetitions;
+}
+
+/**
+ * @brief Report the time of the tiled correlation with 1 to 32 threads.
+ * @param repetitions is the number of runs of each measure.
+ */
+void report_scaling(int repetitions)
+{
+    const cv::Size size(1920, 1080);
+    const int radii[] = {1, 2, 3, 5, 7, 10, 15};
+    const int threads[] = {1, 2, 4, 8, 16, 32};
+    const int default_threads = cv::getNumThreads();
+    cv::RNG rng(0);
+    cv::Mat in(size, CV_32FC1);
+    rng.fill(in, cv::RNG::UNIFORM, 0.0, 1.0);
+
+    std::cout << "Tiled correlation of a " << size.width << "x" << size.height
+              << " image, time in ms (speedup over 1 thread)." << std::endl;
+    std::cout << std::setw(4) << "r" << std::setw(12) << "rows(1)";
+    for (int t : threads)
+        std::cout << std::setw(15) << t;
+    std::cout << std::endl;
+    for (int r : radii)
+    {
+        const int k = 2 * r + 1;
+        cv::Mat filter(k, k, CV_32FC1);
+        rng.fill(filter, cv::RNG::UNIFORM, -1.0, 1.0);
+        // Reference: the row by row correlation with one thread.
+        cv::setNumThreads(1);
+        const double t_rows = measure([&]() { fsiv_dense_filter2D(in, filter); }, repetitions);
+        std::cout << std::setw(4) << r << std::setw(12) << std::fixed
+                  << std::setprecision(1) << t_rows * 1000.0;
+        double t_one = 0.0;
+        for (int t : threads)
+        {
+            cv::setNumThreads(t);
+            const double t_tiled = measure([&]() { fsiv_tiled_filter2D(in, filter); }, repetitions);
+            if (t == 1)
+                t_one = t_tiled;
+            std::cout << std::setw(8) << t_tiled * 1000.0 << " (" << std::setw(4)
+                      << t_one / t_tiled << ")";
+        }
+        std::cout << std::endl;
+    }
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << std::setprecision(6);
+    cv::setNumThreads(default_threads);
+}
+
+int main(int argc, char *const *argv)
+{
+    int retCode = EXIT_SUCCESS;
+
+    try
+    {
+        cv::CommandLineParser parser(argc, argv, keys);
+        parser.about("Benchmark the spatial and DFT correlation. (ver 0.2)");
+        if (parser.has("help"))
+        {
+            parser.printMessage();
+            return 0;
+        }
+        int repetitions = std::max(1, parser.get<int>("n"));
+        double max_macs = parser.get<double>("m");
+        if (!parser.check())
+        {
+            parser.printErrors();
+            return 0;
+        }
+        if (parser.has("s"))
+        {
+            report_scaling(repetitions);
+            return 0;
+        }
+
+        const cv::Size sizes[] = {cv::Size(512, 512), cv::Size(1920, 1080), cv::Size(3840, 2160)};
+        const int radii[] = {1, 2, 3, 5, 8, 12, 16, 25, 32};
+        std::vector<double> ratios;
+        cv::RNG rng(0);
+
+        std::cout << "Threads: " << cv::getNumThreads() << std::endl;
+        std::cout << std::setw(10) << "size" << std::setw(5) << "r"
+                  << std::setw(12) << "dense(ms)" << std::setw(12) << "separ.(ms)"
+                  << std::setw(12) << "dft(ms)" << std::setw(12) << "model" << std::endl;
+        for (const cv::Size &size : sizes)
+        {
+            cv::Mat in(size, CV_32FC1);
+            rng.fill(in, cv::RNG::UNIFORM, 0.0, 1.0);
+            int dense_crossover = -1, separable_crossover = -1;
+            for (int r : radii)
+            {
+                const int k = 2 * r + 1;
+                cv::Mat filter(k, k, CV_32FC1);
+                rng.fill(filter, cv::RNG::UNIFORM, -1.0, 1.0);
+                cv::Mat col = cv::getGaussianKernel(k, -1, CV_32F);
+                cv::Mat row = col.t();
+
+                const double out_area = double(size.width - 2 * r) * (size.height - 2 * r);
+                const double p = double(cv::getOptimalDFTSize(size.width)) *
+                                 cv::getOptimalDFTSize(size.height);
+                double t_dense = -1.0;
+                if (out_area * k * k <= max_macs)
+                    t_dense = measure([&]() { fsiv_dense_filter2D(in, filter); }, repetitions);
+                const double t_sep = measure([&]() { fsiv_separable_filter2D(in, col, row); }, repetitions);
+                fsiv_fft_filter2D(in, filter); // cache the filter spectrum.
+                const double t_fft = measure([&]() { fsiv_fft_filter2D(in, filter); }, repetitions);
+
+                if (t_dense > 0.0)
+                {
+                    // Cost of a P*log2(P) unit in multiply-adds.
+                    ratios.push_back((t_fft / (p * std::log2(p))) / (t_dense / (out_area * k * k)));
+                    if (dense_crossover < 0 && t_fft < t_dense)
+                        dense_crossover = r;
+                }
+                if (separable_crossover < 0 && t_fft < t_sep)
+                    separable_crossover = r;
+
+                std::cout << std::setw(5) << size.width << "x" << std::setw(4) << size.height
+                          << std::setw(5) << r << std::setw(12);
+                if (t_dense > 0.0)
+                    std::cout << t_dense * 1000.0;
+                else
+                    std::cout << "-";
+                std::cout << std::setw(12) << t_sep * 1000.0 << std::setw(12) << t_fft * 1000.0
+                          << std::setw(12) << (fsiv_fft_is_faster(size, filter.size()) ? "dft" : "dense")
+                          << std::endl;
+            }
+            std::cout << "Measured crossover radius for " << size.width << "x" << size.height
+                      << ": dense " << dense_crossover << ", separable " << separable_crossover
+                      << " (-1 means not reached)." << std::endl;
+        }
+
+        if (!ratios.empty())
+        {
+            std::nth_element(ratios.begin(), ratios.begin() + ratios.size() / 2, ratios.end());
+            std::cout << "Current DFT cost ratio : " << fsiv_get_fft_cost_ratio() << std::endl;
+            std::cout << "Measured DFT cost ratio: " << ratios[ratios.size() / 2]
+                      << " (use it with fsiv_set_fft_cost_ratio())." << std::endl;
+        }
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Capturada excepcion: " << e.what() << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    catch (...)
+    {
+        std::cerr << "Capturada excepcion desconocida!" << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    return retCode;
+}
@@ -0,0 +1,198 @@
+/**
+ * @file box_filter.cpp
+ * @brief Box blur with a cost per pixel independent of the radius.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include "box_filter.hpp"
+#include <algorithm>
+#include <vector>
+#include <opencv2/core/utility.hpp>
+
+/**
+ * @brief Map an index of the expanded image to the source image.
+ * @return the source index, or -1 for a zero border.
+ */
+static inline int border_index(int i, int n, bool circular)
+{
+    if (i >= 0 && i < n)
+        return i;
+    if (!circular)
+        return -1;
+    i %= n;
+    return i < 0 ? i + n : i;
+}
+
+// Output columns of a stripe. The ring of window sums of a stripe must fit in
+// the L2 cache.
+static const int STRIPE_COLS = 256;
+
+// Minimum output rows of a band. A band also reads 2r rows around it.
+static const int BAND_ROWS = 128;
+
+/**
+ * @brief Copy a segment of an image row extended r pixels at both sides.
+ * @param src is the row.
+ * @param cols is the number of pixels of the row.
+ * @param x0 is the first pixel of the segment.
+ * @param n is the number of pixels of the segment.
+ * @param r is the extension.
+ * @param circular if the border wraps around instead of being zero.
+ * @param ext is the output buffer, with n+2r values for [x0-r, x0+n+r).
+ */
+static void extend_segment(const float *src, int cols, int x0, int n, int r,
+                           bool circular, float *ext)
+{
+    // Positions inside the row are copied, the others are remapped.
+    const int b = std::min(x0 + n + r, std::max(x0 - r, 0));
+    const int e = std::max(b, std::min(x0 + n + r, cols));
+    for (int x = x0 - r; x < b; ++x)
+    {
+        const int sx = border_index(x, cols, circular);
+        ext[x - x0 + r] = sx < 0 ? 0.0f : src[sx];
+    }
+    std::copy(src + b, src + e, ext + b - x0 + r);
+    for (int x = e; x < x0 + n + r; ++x)
+    {
+        const int sx = border_index(x, cols, circular);
+        ext[x - x0 + r] = sx < 0 ? 0.0f : src[sx];
+    }
+}
+
+/**
+ * @brief Box blur with running sums, maybe followed by unsharp masking.
+ *
+ * The output is computed by tiles of a band of rows and a stripe of columns.
+ * A tile walks down its rows keeping the horizontal window sums of the last
+ * 2r+1 rows in a ring, so only the input, the output and the mask go through
+ * memory.
+ *
+ * @param in is the input image.
+ * @param r is the filter's radius.
+ * @param circular if it is true, it is used circular expansion, else zero padding.
+ * @param usm if true, return (1+g)*in - g*blur instead of blur.
+ * @param g is the enhance's gain.
+ * @param mask if not nullptr and usm is true, output the blurred image.
+ */
+static cv::Mat
+box_blur(cv::Mat const &in, const int r, bool circular, bool usm, double g,
+         cv::Mat *mask)
+{
+    const int k = 2 * r + 1;
+    const int band_rows = std::max(BAND_ROWS, 4 * k);
+    const int n_bands = (in.rows + band_rows - 1) / band_rows;
+    const int n_stripes = (in.cols + STRIPE_COLS - 1) / STRIPE_COLS;
+    const double scale = 1.0 / (double(k) * k);
+    const float a = float(1.0 + g);
+    const float b = float(-g);
+    cv::Mat ret_v(in.rows, in.cols, CV_32FC1);
+    if (usm && mask != nullptr)
+        mask->create(in.size(), CV_32FC1);
+
+    cv::parallel_for_(cv::Range(0, n_bands * n_stripes), [&](const cv::Range &range)
+    {
+        std::vector<float> ext(STRIPE_COLS + 2 * r);
+        // Horizontal window sums of the last k+1 rows. The sums are kept in
+        // double so adding and subtracting does not accumulate rounding errors.
+        std::vector<double> ring((k + 1) * STRIPE_COLS);
+        std::vector<double> sums(STRIPE_COLS);
+        for (int t = range.start; t < range.end; ++t)
+        {
+            const int y0 = (t / n_stripes) * band_rows;
+            const int y1 = std::min(in.rows, y0 + band_rows);
+            const int x0 = (t % n_stripes) * STRIPE_COLS;
+            const int n = std::min(STRIPE_COLS, in.cols - x0);
+
+            // Horizontal window sums of the row j of the expanded image. The
+            // rows out of the image are mapped to their source row, or are
+            // zero for a zero border.
+            auto row_sums = [&](int j) -> const double *
+            {
+                double *dst = &ring[((j - y0 + r) % (k + 1)) * STRIPE_COLS];
+                const int sy = border_index(j, in.rows, circular);
+                if (sy < 0)
+                {
+                    std::fill(dst, dst + n, 0.0);
+                    return dst;
+                }
+                extend_segment(in.ptr<float>(sy), in.cols, x0, n, r, circular, ext.data());
+                double sum = 0.0;
+                for (int x = 0; x < k; ++x)
+                    sum += ext[x];
+                dst[0] = sum;
+                for (int x = 1; x < n; ++x)
+                {
+                    sum += double(ext[x + k - 1]) - ext[x - 1];
+                    dst[x] = sum;
+                }
+                return dst;
+            };
+
+            // Vertical window sums, updated with the entering and leaving rows.
+            std::fill(sums.begin(), sums.begin() + n, 0.0);
+            for (int j = y0 - r; j <= y0 + r; ++j)
+            {
+                const double *h = row_sums(j);
+                for (int x = 0; x < n; ++x)
+                    sums[x] += h[x];
+            }
+            for (int y = y0; y < y1; ++y)
+            {
+                if (y > y0)
+                {
+                    const double *enter = row_sums(y + r);
+                    const double *leave = &ring[((y - 1 - y0) % (k + 1)) * STRIPE_COLS];
+                    for (int x = 0; x < n; ++x)
+                        sums[x] += enter[x] - leave[x];
+                }
+                float *dst = ret_v.ptr<float>(y) + x0;
+                if (!usm)
+                    for (int x = 0; x < n; ++x)
+                        dst[x] = float(sums[x] * scale);
+                else
+                {
+                    // The enhanced value is written in the same pass as the blur.
+                    const float *orig = in.ptr<float>(y) + x0;
+                    float *m = mask ? mask->ptr<float>(y) + x0 : nullptr;
+                    for (int x = 0; x < n; ++x)
+                    {
+                        const float blur = float(sums[x] * scale);
+                        if (m)
+                            m[x] = blur;
+                        dst[x] = a * orig[x] + b * blur;
+                    }
+                }
+            }
+        }
+    });
+    return ret_v;
+}
+
+cv::Mat
+fsiv_box_blur(cv::Mat const &in, const int r, bool circular)
+{
+    CV_Assert(!in.empty());
+    CV_Assert(in.type() == CV_32FC1);
+    CV_Assert(r > 0);
+    cv::Mat ret_v = box_blur(in, r, circular, false, 0.0, nullptr);
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.rows == in.rows && ret_v.cols == in.cols);
+    return ret_v;
+}
+
+cv::Mat
+fsiv_box_usm(cv::Mat const &in, const int r, double g, bool circular,
+             cv::Mat *unsharp_mask)
+{
+    CV_Assert(!in.empty());
+    CV_Assert(in.type() == CV_32FC1);
+    CV_Assert(r > 0);
+    CV_Assert(g >= 0.0);
+    cv::Mat ret_v = box_blur(in, r, circular, true, g, unsharp_mask);
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.rows == in.rows && ret_v.cols == in.cols);
+    return ret_v;
+}
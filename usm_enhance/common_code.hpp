@@ -93,14 +93,15 @@ cv::Mat fsiv_combine_images(const cv::Mat src1, const cv::Mat src2,
  * @arg[in] in is the input image.
  * @arg[in] g is the enhance's gain.
  * @arg[in] r is the window's radius.
- * @arg[in] filter_type specifies which filter to use. 0->Box, 1->Gaussian.
+ * @arg[in] filter_type specifies which filter to use. 0->Box, 1->Gaussian,
+ *          2->recursive Gaussian (see recursive_gaussian.hpp).
  * @arg[in] circular specifies if it is true, it be used circular expansion to do the convolution, else it is used zero padding.
  * @arg[out] unsharp_mask if it is not nullptr, save the unsharp mask used.
  * @pre !in.empty()
  * @pre in.type()==CV_32FC1
  * @pre g>=0.0
  * @pre r>0
- * @pre filter_type is {0, 1}
+ * @pre filter_type is {0, 1, 2}
  * @post ret_v.rows==in.rows && ret_v.cols==in.cols
  * @post ret_v.type()==CV_32FC1
  */
@@ -0,0 +1,180 @@
+/**
+ * @file recursive_gaussian.cpp
+ * @brief Gaussian blur with a recursive (IIR) filter.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include "recursive_gaussian.hpp"
+#include "convolution.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <opencv2/core/utility.hpp>
+#include <opencv2/imgproc.hpp>
+
+// Number of columns filtered together by a thread.
+static const int COLUMN_BLOCK = 32;
+
+// Border, in sigmas, after which the tail of the filter response is ignored.
+static const double MARGIN_SIGMAS = 6.0;
+
+// Smaller sigmas use the FIR kernel: the recursive filter is not accurate for
+// them (see recursive_gaussian.hpp).
+static const double MIN_RECURSIVE_SIGMA = 2.0;
+
+// Radius, in sigmas, of the FIR kernel of a sigma that is not the one of a radius.
+static const double FIR_SIGMAS = 3.0;
+
+/**
+ * @brief Coefficients of the Young-van Vliet recursive filter.
+ *
+ * w[n] = B*x[n] + b1*w[n-1] + b2*w[n-2] + b3*w[n-3] (forward)
+ * y[n] = B*w[n] + b1*y[n+1] + b2*y[n+2] + b3*y[n+3] (backward)
+ */
+typedef struct
+{
+    float B;
+    float b1;
+    float b2;
+    float b3;
+} YvvCoefficients;
+
+static YvvCoefficients yvv_coefficients(double sigma)
+{
+    const double q = (sigma >= 2.5) ? 0.98711 * sigma - 0.96330
+                                    : 3.97156 - 4.14554 * std::sqrt(1.0 - 0.26891 * sigma);
+    const double q2 = q * q;
+    const double q3 = q2 * q;
+    const double b0 = 1.57825 + 2.44413 * q + 1.4281 * q2 + 0.422205 * q3;
+    const double b1 = (2.44413 * q + 2.85619 * q2 + 1.26661 * q3) / b0;
+    const double b2 = -(1.4281 * q2 + 1.26661 * q3) / b0;
+    const double b3 = 0.422205 * q3 / b0;
+    YvvCoefficients c;
+    c.B = float(1.0 - (b1 + b2 + b3));
+    c.b1 = float(b1);
+    c.b2 = float(b2);
+    c.b3 = float(b3);
+    return c;
+}
+
+/**
+ * @brief Map an index of the expanded image to the source image.
+ * @return the source index, or -1 for a zero border.
+ */
+static inline int border_index(int i, int n, bool circular)
+{
+    if (i >= 0 && i < n)
+        return i;
+    if (!circular)
+        return -1;
+    i %= n;
+    return i < 0 ? i + n : i;
+}
+
+/**
+ * @brief Run the recursive filter down the columns of an image.
+ *
+ * Each step updates a whole block of columns, so the recursion runs along the
+ * rows and the inner loop is vectorized across the columns.
+ *
+ * @param src is the input image (CV_32FC1).
+ * @param c are the filter coefficients.
+ * @param m is the number of border rows filtered before and after the image.
+ * @param circular if the border wraps around instead of being zero.
+ * @return the filtered image.
+ */
+static cv::Mat recursive_columns(const cv::Mat &src, const YvvCoefficients &c,
+                                 int m, bool circular)
+{
+    cv::Mat dst(src.size(), CV_32FC1);
+    const int n = src.rows + 2 * m;
+    const int n_blocks = (src.cols + COLUMN_BLOCK - 1) / COLUMN_BLOCK;
+    cv::parallel_for_(cv::Range(0, n_blocks), [&](const cv::Range &range)
+    {
+        // Forward pass result, with three zero rows before the first one.
+        std::vector<float> w((n + 3) * COLUMN_BLOCK);
+        std::vector<float> y(4 * COLUMN_BLOCK);
+        for (int b = range.start; b < range.end; ++b)
+        {
+            const int x0 = b * COLUMN_BLOCK;
+            const int bw = std::min(COLUMN_BLOCK, src.cols - x0);
+            std::fill(w.begin(), w.begin() + 3 * COLUMN_BLOCK, 0.0f);
+            for (int i = 0; i < n; ++i)
+            {
+                float *w0 = &w[(i + 3) * COLUMN_BLOCK];
+                const float *w1 = w0 - COLUMN_BLOCK;
+                const float *w2 = w1 - COLUMN_BLOCK;
+                const float *w3 = w2 - COLUMN_BLOCK;
+                const int sy = border_index(i - m, src.rows, circular);
+                if (sy < 0)
+                    for (int x = 0; x < bw; ++x)
+                        w0[x] = c.b1 * w1[x] + c.b2 * w2[x] + c.b3 * w3[x];
+                else
+                {
+                    const float *s = src.ptr<float>(sy) + x0;
+                    for (int x = 0; x < bw; ++x)
+                        w0[x] = c.B * s[x] + c.b1 * w1[x] + c.b2 * w2[x] + c.b3 * w3[x];
+                }
+            }
+
+            // Backward pass, keeping the last three outputs in a ring.
+            std::fill(y.begin(), y.end(), 0.0f);
+            for (int i = n - 1; i >= 0; --i)
+            {
+                float *y0 = &y[(i & 3) * COLUMN_BLOCK];
+                const float *y1 = &y[((i + 1) & 3) * COLUMN_BLOCK];
+                const float *y2 = &y[((i + 2) & 3) * COLUMN_BLOCK];
+                const float *y3 = &y[((i + 3) & 3) * COLUMN_BLOCK];
+                const float *w0 = &w[(i + 3) * COLUMN_BLOCK];
+                for (int x = 0; x < bw; ++x)
+                    y0[x] = c.B * w0[x] + c.b1 * y1[x] + c.b2 * y2[x] + c.b3 * y3[x];
+                if (i >= m && i < m + src.rows)
+                    std::copy(y0, y0 + bw, dst.ptr<float>(i - m) + x0);
+            }
+        }
+    });
+    return dst;
+}
+
+double fsiv_gaussian_sigma(int r)
+{
+    CV_Assert(r > 0);
+    return 0.3 * (r - 1) + 0.8;
+}
+
+cv::Mat
+fsiv_recursive_gaussian_blur(cv::Mat const &in, double sigma, bool circular)
+{
+    CV_Assert(!in.empty());
+    CV_Assert(in.type() == CV_32FC1);
+    CV_Assert(sigma >= 0.5);
+    if (sigma < MIN_RECURSIVE_SIGMA)
+    {
+        // The FIR kernel of the radius with this sigma, as
+        // fsiv_create_gaussian_filter, or else a sampled Gaussian.
+        const int r = std::max(1, cvRound((sigma - 0.8) / 0.3) + 1);
+        const cv::Mat k = (std::abs(fsiv_gaussian_sigma(r) - sigma) < 1.0e-6)
+                              ? cv::getGaussianKernel(2 * r + 1, -1, CV_32F)
+                              : cv::getGaussianKernel(2 * int(std::ceil(FIR_SIGMAS * sigma)) + 1,
+                                                      sigma, CV_32F);
+        cv::Mat ret_v = fsiv_separable_border_filter2D(in, k, k.t(), circular);
+        CV_Assert(ret_v.type() == CV_32FC1);
+        CV_Assert(ret_v.size() == in.size());
+        return ret_v;
+    }
+    const YvvCoefficients c = yvv_coefficients(sigma);
+    const int m = int(std::ceil(MARGIN_SIGMAS * sigma)) + 3;
+
+    // The rows are filtered as the columns of the transposed image.
+    cv::Mat tmp;
+    cv::transpose(recursive_columns(in, c, m, circular), tmp);
+    cv::Mat ret_v;
+    cv::transpose(recursive_columns(tmp, c, m, circular), ret_v);
+
+    CV_Assert(ret_v.type() == CV_32FC1);
+    CV_Assert(ret_v.size() == in.size());
+    return ret_v;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file recursive_gaussian.hpp
+ * @brief Gaussian blur with a recursive (IIR) filter.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#pragma once
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Get the standard deviation of the Gaussian filter of a radius.
+ *
+ * It is the sigma used by cv::getGaussianKernel(2*r+1, -1).
+ *
+ * @arg[in] r is the filter's radius.
+ * @return 0.3*(r-1)+0.8
+ * @pre r>0
+ */
+double fsiv_gaussian_sigma(int r);
+
+/**
+ * @brief Blur an image with a recursive Gaussian filter.
+ *
+ * Uses the third order Young-van Vliet recursive filter, run forward and
+ * backward along the columns and then along the rows, so the cost per pixel
+ * does not depend on sigma (for sigma>=2, see below). Each recursion step updates a block of columns,
+ * so the inner loop is vectorized. The border (zero or circular) is filtered
+ * for 6*sigma pixels before and after the image.
+ *
+ * Accuracy: the maximum absolute difference of the recursive filter against
+ * the FIR filter fsiv_create_gaussian_filter(r) with sigma=fsiv_gaussian_sigma(r),
+ * for images in [0, 1], is:
+ *
+ * | r            | 1    | 2    | 3    | 4    | 5    | 8     | 16    | 32    |
+ * |--------------|------|------|------|------|------|-------|-------|-------|
+ * | step edge    | 0.12 | 0.089| 0.054| 0.044| 0.039| 0.026 | 0.024 | 0.017 |
+ * | random noise | 0.12 | 0.090| 0.039| 0.033| 0.026| 0.015 | 0.013 | 0.009 |
+ *
+ * For r<=3 the FIR kernels are not sampled Gaussians, and for larger radii
+ * the difference comes from the tails of the recursive filter, which are
+ * longer than the FIR ones (truncated at about 3.2 sigmas). The largest errors
+ * are next to strong edges. So, for sigma<2 (r<5) the FIR kernel is applied
+ * instead with fsiv_separable_border_filter2D: the kernel of
+ * fsiv_create_gaussian_filter(r) if sigma is fsiv_gaussian_sigma(r), else a
+ * Gaussian sampled up to 3 sigmas, so at most 2*13 multiply-adds per pixel.
+ * test_recursive_gaussian checks these bounds.
+ *
+ * @arg[in] in is the input image.
+ * @arg[in] sigma is the standard deviation of the Gaussian.
+ * @arg[in] circular if it is true, it is used circular expansion, else zero padding.
+ * @return the blurred image.
+ * @pre !in.empty()
+ * @pre in.type()==CV_32FC1
+ * @pre sigma>=0.5
+ * @post ret_v.type()==CV_32FC1
+ * @post ret_v.size()==in.size()
+ */
+cv::Mat fsiv_recursive_gaussian_blur(cv::Mat const &in, double sigma,
+                                     bool circular = false);
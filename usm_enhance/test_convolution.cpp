@@ -0,0 +1,215 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <exception>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "convolution.hpp"
+
+/**
+ * @brief Correlate an expanded image with the path fsiv_filter2D uses for the filter.
+ * @param in is the image.
+ * @param filter is the filter.
+ * @param circular if the image is expanded wrapping around instead of with zeros.
+ * @return the valid area of the correlation of the expanded image.
+ */
+static cv::Mat my_border_filter2D(const cv::Mat &in, const cv::Mat &filter, bool circular)
+{
+    cv::Mat expanded;
+    cv::copyMakeBorder(in, expanded, filter.rows / 2, filter.rows / 2,
+                       filter.cols / 2, filter.cols / 2,
+                       circular ? cv::BORDER_WRAP : cv::BORDER_CONSTANT, cv::Scalar(0));
+    cv::Mat col, row;
+    if (fsiv_separate_filter(filter, col, row))
+        return fsiv_separable_filter2D(expanded, col, row);
+    return fsiv_dense_filter2D(expanded, filter);
+}
+
+/**
+ * @brief Compare two images and save the test data if they differ more than a tolerance.
+ * @param label is the test label.
+ * @param in is the input image.
+ * @param filter is the filter.
+ * @param my_out is the reference output.
+ * @param your_out is the tested output.
+ * @param tolerance is the maximum allowed absolute difference.
+ * @param tests is the test counter.
+ * @param seed is the random seed, used to name the data file of a fail.
+ * @return true if the test passes.
+ */
+static bool check(const std::string &label, const cv::Mat &in, const cv::Mat &filter,
+                  const cv::Mat &my_out, const cv::Mat &your_out,
+                  double tolerance, int tests, cv::uint64_t seed)
+{
+    std::cout << label << " ... ";
+    const double norm_v = (my_out.size() == your_out.size())
+                              ? cv::norm(my_out, your_out, cv::NORM_INF)
+                              : -1.0;
+    if (norm_v >= 0.0 && norm_v <= tolerance)
+    {
+        std::cout << " Ok!" << std::endl;
+        return true;
+    }
+    std::ostringstream fname;
+    fname << "test-" << tests << '-' << seed << ".xml";
+    std::cerr << "Test fail: cv::norm(my_out, your_out, cv::NORM_INF)=" << norm_v
+              << " (should be <= " << tolerance << "!)" << std::endl;
+    std::cerr << "\t test data file: " << fname.str() << std::endl;
+    auto file = cv::FileStorage();
+    file.open(fname.str(), cv::FileStorage::WRITE);
+    file << "Linf" << norm_v;
+    file << "in" << in;
+    file << "filter" << filter;
+    file << "my_out" << my_out;
+    file << "your_out" << your_out;
+    file.release();
+    return false;
+}
+
+int main(int argc, char *const *argv)
+{
+    int retCode = EXIT_SUCCESS;
+    int tests_passed = 0;
+    int tests = 0;
+    cv::uint64_t seed = 0;
+    if (argc > 1)
+        seed = static_cast<cv::uint64_t>(std::atoll(argv[1]));
+    else
+        seed = cv::getTickCount();
+    std::cerr << "Random seed: " << seed << std::endl;
+    cv::RNG rng(seed);
+
+    // Image sizes (rows, cols) and filter radius: odd sizes, thin images,
+    // borders wider than the interior and images with several tiles.
+    const int cases[][3] = {{37, 53, 1}, {64, 64, 3}, {101, 7, 2}, {9, 120, 4},
+                            {31, 31, 7}, {12, 15, 5}, {300, 600, 3}, {270, 530, 12}};
+    const char *filter_names[] = {"box", "Gaussian", "dense"};
+
+    try
+    {
+        for (const auto &c : cases)
+            for (int f = 0; f < 3; ++f)
+                for (int circular = 0; circular < 2; ++circular)
+                {
+                    const int r = c[2];
+                    cv::Mat in(c[0], c[1], CV_32FC1);
+                    rng.fill(in, cv::RNG::UNIFORM, 0, 256);
+                    in.convertTo(in, CV_32F, 1.0 / 255.0);
+                    cv::Mat filter;
+                    if (f == 0)
+                        filter = cv::Mat(2 * r + 1, 2 * r + 1, CV_32FC1, cv::Scalar(1.0 / ((2 * r + 1) * (2 * r + 1))));
+                    else if (f == 1)
+                    {
+                        const cv::Mat k = cv::getGaussianKernel(2 * r + 1, -1, CV_32F);
+                        filter = k * k.t();
+                    }
+                    else
+                    {
+                        filter = cv::Mat(2 * r + 1, 2 * r + 1, CV_32FC1);
+                        rng.fill(filter, cv::RNG::UNIFORM, -5, 6);
+                        filter.convertTo(filter, CV_32F, 0.1);
+                    }
+                    std::ostringstream params;
+                    params << "(" << c[0] << "x" << c[1] << ", " << filter_names[f]
+                           << " r=" << r << (circular ? ", circular" : ", zero") << ")";
+                    const cv::Mat my_out = my_border_filter2D(in, filter, circular != 0);
+
+                    // Same summation order as the expanded paths.
+                    for (int tiled = 0; tiled < 2; ++tiled)
+                    {
+                        try
+                        {
+                            tests++;
+                            fsiv_set_tiled_convolution(tiled != 0);
+                            const cv::Mat your_out = fsiv_border_filter2D(in, filter, circular != 0);
+                            fsiv_set_tiled_convolution(true);
+                            if (check(std::string("fsiv_border_filter2D ") + params.str() +
+                                          (tiled ? "" : " not tiled"),
+                                      in, filter, my_out, your_out, 0.0, tests, seed))
+                                tests_passed++;
+                        }
+                        catch (std::exception &e)
+                        {
+                            std::cerr << "Error: " << e.what() << std::endl;
+                        }
+                        catch (...)
+                        {
+                            std::cerr << "Error: unknown exception!!." << std::endl;
+                        }
+                    }
+
+                    // The 1D filters given directly, with the same summation order.
+                    if (f < 2)
+                    {
+                        try
+                        {
+                            tests++;
+                            const cv::Mat col = (f == 0)
+                                                    ? cv::Mat(2 * r + 1, 1, CV_32FC1, cv::Scalar(1.0 / (2 * r + 1)))
+                                                    : cv::getGaussianKernel(2 * r + 1, -1, CV_32F);
+                            const cv::Mat row = col.t();
+                            cv::Mat expanded;
+                            cv::copyMakeBorder(in, expanded, r, r, r, r,
+                                               circular ? cv::BORDER_WRAP : cv::BORDER_CONSTANT, cv::Scalar(0));
+                            const cv::Mat my_sep = fsiv_separable_filter2D(expanded, col, row);
+                            const cv::Mat your_sep = fsiv_separable_border_filter2D(in, col, row, circular != 0);
+                            if (check("fsiv_separable_border_filter2D " + params.str(), in, filter,
+                                      my_sep, your_sep, 0.0, tests, seed))
+                                tests_passed++;
+                        }
+                        catch (std::exception &e)
+                        {
+                            std::cerr << "Error: " << e.what() << std::endl;
+                        }
+                        catch (...)
+                        {
+                            std::cerr << "Error: unknown exception!!." << std::endl;
+                        }
+                    }
+
+                    // The enhance is done in float, fsiv_combine_images in double.
+                    // fsiv_usm_combine must give the same image from the mask.
+                    try
+                    {
+                        tests++;
+                        const double g = 1.5;
+                        cv::Mat my_usm, your_usm, your_mask;
+                        cv::addWeighted(in, 1.0 + g, my_out, -g, 0.0, my_usm);
+                        your_usm = fsiv_border_usm(in, filter, circular != 0, g, &your_mask);
+                        if (check("fsiv_border_usm " + params.str(), in, filter,
+                                  my_usm, your_usm, 1.0e-5, tests, seed) &&
+                            check("fsiv_border_usm (mask) " + params.str(), in, filter,
+                                  my_out, your_mask, 0.0, tests, seed) &&
+                            check("fsiv_usm_combine " + params.str(), in, filter,
+                                  your_usm, fsiv_usm_combine(in, your_mask, g), 0.0, tests, seed))
+                            tests_passed++;
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "Error: unknown exception!!." << std::endl;
+                    }
+                }
+
+        std::cout << "You pass " << tests_passed << " of " << tests << " tests." << std::endl;
+        if (tests_passed != tests)
+            retCode = EXIT_FAILURE;
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    catch (...)
+    {
+        std::cerr << "Error: unknown exception!!." << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    return retCode;
+}
@@ -0,0 +1,138 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <exception>
+
+#include <opencv2/core/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "convolution.hpp"
+#include "recursive_gaussian.hpp"
+
+/**
+ * @brief Blur an image with the FIR filter fsiv_create_gaussian_filter(r).
+ * @param in is the input image.
+ * @param r is the filter's radius.
+ * @param circular if the border wraps around instead of being zero.
+ * @return the blurred image.
+ */
+static cv::Mat my_gaussian_blur(const cv::Mat &in, int r, bool circular)
+{
+    const cv::Mat k = cv::getGaussianKernel(2 * r + 1, -1, CV_32F);
+    return fsiv_separable_border_filter2D(in, k, k.t(), circular);
+}
+
+/**
+ * @brief Compare two images and save the test data if they differ more than a tolerance.
+ * @param label is the test label.
+ * @param in is the input image.
+ * @param my_out is the reference output.
+ * @param your_out is the tested output.
+ * @param tolerance is the maximum allowed absolute difference.
+ * @param tests is the test counter.
+ * @param seed is the random seed, used to name the data file of a fail.
+ * @return true if the test passes.
+ */
+static bool check(const std::string &label, const cv::Mat &in,
+                  const cv::Mat &my_out, const cv::Mat &your_out,
+                  double tolerance, int tests, cv::uint64_t seed)
+{
+    std::cout << label << " ... ";
+    const double norm_v = (my_out.size() == your_out.size())
+                              ? cv::norm(my_out, your_out, cv::NORM_INF)
+                              : -1.0;
+    if (norm_v >= 0.0 && norm_v <= tolerance)
+    {
+        std::cout << " Ok! (Linf=" << norm_v << ")" << std::endl;
+        return true;
+    }
+    std::ostringstream fname;
+    fname << "test-" << tests << '-' << seed << ".xml";
+    std::cerr << "Test fail: cv::norm(my_out, your_out, cv::NORM_INF)=" << norm_v
+              << " (should be <= " << tolerance << "!)" << std::endl;
+    std::cerr << "\t test data file: " << fname.str() << std::endl;
+    auto file = cv::FileStorage();
+    file.open(fname.str(), cv::FileStorage::WRITE);
+    file << "Linf" << norm_v;
+    file << "in" << in;
+    file << "my_out" << my_out;
+    file << "your_out" << your_out;
+    file.release();
+    return false;
+}
+
+int main(int argc, char *const *argv)
+{
+    int retCode = EXIT_SUCCESS;
+    int tests_passed = 0;
+    int tests = 0;
+    cv::uint64_t seed = 0;
+    if (argc > 1)
+        seed = static_cast<cv::uint64_t>(std::atoll(argv[1]));
+    else
+        seed = cv::getTickCount();
+    std::cerr << "Random seed: " << seed << std::endl;
+    cv::RNG rng(seed);
+
+    // Radius and maximum error against the FIR filter, from the accuracy
+    // table of recursive_gaussian.hpp. Below sigma 2 (r<5) the FIR kernel is
+    // used, so the result must be the same.
+    const double radii[][2] = {{1, 0.0}, {2, 0.0}, {3, 0.0}, {4, 0.0},
+                               {5, 0.04}, {8, 0.027}, {16, 0.025}, {32, 0.018}};
+    const char *image_names[] = {"step edge", "random noise"};
+
+    try
+    {
+        for (const auto &c : radii)
+            for (int image = 0; image < 2; ++image)
+                for (int circular = 0; circular < 2; ++circular)
+                {
+                    try
+                    {
+                        tests++;
+                        const int r = int(c[0]);
+                        cv::Mat in = cv::Mat::zeros(256, 256, CV_32FC1);
+                        if (image == 0)
+                            in(cv::Rect(64, 64, 128, 128)).setTo(1.0);
+                        else
+                        {
+                            rng.fill(in, cv::RNG::UNIFORM, 0, 256);
+                            in.convertTo(in, CV_32F, 1.0 / 255.0);
+                        }
+                        std::ostringstream label;
+                        label << "fsiv_recursive_gaussian_blur (" << image_names[image]
+                              << ", r=" << r << ", sigma=" << fsiv_gaussian_sigma(r)
+                              << (circular ? ", circular" : ", zero") << ")";
+                        const cv::Mat my_out = my_gaussian_blur(in, r, circular != 0);
+                        const cv::Mat your_out = fsiv_recursive_gaussian_blur(in, fsiv_gaussian_sigma(r),
+                                                                              circular != 0);
+                        if (check(label.str(), in, my_out, your_out, c[1], tests, seed))
+                            tests_passed++;
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "Error: unknown exception!!." << std::endl;
+                    }
+                }
+
+        std::cout << "You pass " << tests_passed << " of " << tests << " tests." << std::endl;
+        if (tests_passed != tests)
+            retCode = EXIT_FAILURE;
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    catch (...)
+    {
+        std::cerr << "Error: unknown exception!!." << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    return retCode;
+}
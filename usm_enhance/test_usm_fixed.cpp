@@ -0,0 +1,150 @@
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <exception>
+
+#include <opencv2/core/core.hpp>
+
+#include "common_code.hpp"
+#include "usm_fixed.hpp"
+
+/**
+ * @brief Enhance an 8-bit image with the float path, channel by channel.
+ * @param in is the input image.
+ * @param g is the enhance's gain.
+ * @param r is the window's radius.
+ * @param filter_type 0->Box, 1->Gaussian.
+ * @param circular if it is true, use circular convolution.
+ * @param unsharp_mask output the blurred image (8-bit).
+ * @return the enhanced image scaled to [0, 255] and saturated.
+ */
+static cv::Mat my_usm_enhance_u8(const cv::Mat &in, double g, int r, int filter_type,
+                                 bool circular, cv::Mat &unsharp_mask)
+{
+    std::vector<cv::Mat> channels, outs, masks;
+    cv::split(in, channels);
+    for (size_t c = 0; c < channels.size(); ++c)
+    {
+        cv::Mat in_f, mask_f, out, mask;
+        channels[c].convertTo(in_f, CV_32F, 1.0 / 255.0);
+        fsiv_usm_enhance(in_f, g, r, filter_type, circular, &mask_f).convertTo(out, CV_8U, 255.0);
+        mask_f.convertTo(mask, CV_8U, 255.0);
+        outs.push_back(out);
+        masks.push_back(mask);
+    }
+    cv::Mat ret_v;
+    cv::merge(outs, ret_v);
+    cv::merge(masks, unsharp_mask);
+    return ret_v;
+}
+
+/**
+ * @brief Compare two images and save the test data if they differ more than a tolerance.
+ * @param label is the test label.
+ * @param in is the input image.
+ * @param my_out is the reference output.
+ * @param your_out is the tested output.
+ * @param tolerance is the maximum allowed absolute difference.
+ * @param tests is the test counter.
+ * @param seed is the random seed, used to name the data file of a fail.
+ * @return true if the test passes.
+ */
+static bool check(const std::string &label, const cv::Mat &in,
+                  const cv::Mat &my_out, const cv::Mat &your_out,
+                  double tolerance, int tests, cv::uint64_t seed)
+{
+    std::cout << label << " ... ";
+    const double norm_v = (my_out.size() == your_out.size() && my_out.type() == your_out.type())
+                              ? cv::norm(my_out, your_out, cv::NORM_INF)
+                              : -1.0;
+    if (norm_v >= 0.0 && norm_v <= tolerance)
+    {
+        std::cout << " Ok!" << std::endl;
+        return true;
+    }
+    std::ostringstream fname;
+    fname << "test-" << tests << '-' << seed << ".xml";
+    std::cerr << "Test fail: cv::norm(my_out, your_out, cv::NORM_INF)=" << norm_v
+              << " (should be <= " << tolerance << "!)" << std::endl;
+    std::cerr << "\t test data file: " << fname.str() << std::endl;
+    auto file = cv::FileStorage();
+    file.open(fname.str(), cv::FileStorage::WRITE);
+    file << "Linf" << norm_v;
+    file << "in" << in;
+    file << "my_out" << my_out;
+    file << "your_out" << your_out;
+    file.release();
+    return false;
+}
+
+int main(int argc, char *const *argv)
+{
+    int retCode = EXIT_SUCCESS;
+    int tests_passed = 0;
+    int tests = 0;
+    cv::uint64_t seed = 0;
+    if (argc > 1)
+        seed = static_cast<cv::uint64_t>(std::atoll(argv[1]));
+    else
+        seed = cv::getTickCount();
+    std::cerr << "Random seed: " << seed << std::endl;
+    cv::RNG rng(seed);
+
+    // Image sizes (rows, cols), channels and radius: odd sizes, thin images
+    // and windows wider than the image.
+    const int cases[][4] = {{37, 53, 1, 1}, {64, 64, 3, 3}, {101, 7, 1, 2},
+                            {9, 120, 4, 4}, {31, 31, 1, 7}, {12, 15, 3, 9}};
+    const char *filter_names[] = {"box", "Gaussian"};
+
+    try
+    {
+        for (const auto &c : cases)
+            for (int filter_type = 0; filter_type < 2; ++filter_type)
+                for (int circular = 0; circular < 2; ++circular)
+                {
+                    try
+                    {
+                        tests++;
+                        const int r = c[3];
+                        const double g = rng.uniform(0, 1001) / 100.0;
+                        cv::Mat in(c[0], c[1], CV_8UC(c[2]));
+                        rng.fill(in, cv::RNG::UNIFORM, 0, 256);
+                        std::ostringstream params;
+                        params << "(" << c[0] << "x" << c[1] << "x" << c[2] << ", "
+                               << filter_names[filter_type] << " r=" << r << ", g=" << g
+                               << (circular ? ", circular" : ", zero") << ")";
+                        cv::Mat my_mask, your_mask;
+                        const cv::Mat my_out = my_usm_enhance_u8(in, g, r, filter_type, circular != 0, my_mask);
+                        const cv::Mat your_out = fsiv_usm_enhance_u8(in, g, r, filter_type, circular != 0, &your_mask);
+                        if (check("fsiv_usm_enhance_u8 " + params.str(), in, my_out, your_out, 1.0, tests, seed) &&
+                            check("fsiv_usm_enhance_u8 (mask) " + params.str(), in, my_mask, your_mask, 1.0, tests, seed))
+                            tests_passed++;
+                    }
+                    catch (std::exception &e)
+                    {
+                        std::cerr << "Error: " << e.what() << std::endl;
+                    }
+                    catch (...)
+                    {
+                        std::cerr << "Error: unknown exception!!." << std::endl;
+                    }
+                }
+
+        std::cout << "You pass " << tests_passed << " of " << tests << " tests." << std::endl;
+        if (tests_passed != tests)
+            retCode = EXIT_FAILURE;
+    }
+    catch (std::exception &e)
+    {
+        std::cerr << "Caught exception: " << e.what() << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    catch (...)
+    {
+        std::cerr << "Error: unknown exception!!." << std::endl;
+        retCode = EXIT_FAILURE;
+    }
+    return retCode;
+}
@@ -17,6 +17,9 @@
 #include <opencv2/imgproc/imgproc.hpp>
 
 #include "common_code.hpp"
+#include "fft_convolution.hpp"
+#include "usm_fixed.hpp"
+#include "usm_session.hpp"
 
 const cv::String keys =
     "{help h usage ? |      | print this message.}"
@@ -24,7 +27,9 @@ const cv::String keys =
     "{r radius       |1     | Window's radius. Default 1.}"
     "{g gain         |1.0   | Enhance's gain. Default 1.0}"
     "{c circular     |      | Use circular convolution.}"
-    "{f filter       |0     | Filter type: 0->Box, 1->Gaussian. Default 0.}"
+    "{f filter       |0     | Filter type: 0->Box, 1->Gaussian, 2->Recursive Gaussian. Default 0.}"
+    "{x fixed        |      | Process 8-bit images with integer arithmetic. Colour images are enhanced per channel.}"
+    "{fft_ratio      |2.0   | Cost of the DFT correlation relative to the spatial one. Measure it with bench_convolution.}"
     "{@input         |<none>| input image.}"
     "{@output        |<none>| output image.}";
 
@@ -38,23 +43,35 @@ struct UserData
     cv::Mat in;                    // input image.
     std::vector<cv::Mat> channels; // HSV channels.
     cv::Mat luma;                  // luma/V to be enhanced.
+    UsmSession session;            // keeps the luma blur while only g changes.
     cv::Mat out;                   // output image.
     cv::Mat unsharp_mask;          // unsharp mask used to do the enhance.
     int r;                         // Windows' radius.
     double g;                      // Enhance's gain.
     int f;                         // filter type.
     int circular;                  // use circular expansion.
+    bool fixed_point;              // enhance the 8-bit image with integers.
     bool interactive;              // interactive mode is activated.
 };
 
 /**@brief Do the gui work**/
 void do_the_work(UserData *user_data)
 {
-    user_data->out = fsiv_usm_enhance(user_data->luma, user_data->g,
-                                      user_data->r, user_data->f,
-                                      user_data->circular,
-                                      &user_data->unsharp_mask);
-    if (user_data->channels.size() == 3)
+    const int64 t0 = cv::getTickCount();
+    bool reused = false;
+    if (user_data->fixed_point)
+        user_data->out = fsiv_usm_enhance_u8(user_data->in, user_data->g,
+                                             user_data->r, user_data->f,
+                                             user_data->circular,
+                                             &user_data->unsharp_mask);
+    else
+    {
+        user_data->out = user_data->session.apply(user_data->g, user_data->r,
+                                                  user_data->f, user_data->circular,
+                                                  &user_data->unsharp_mask);
+        reused = user_data->session.blur_was_reused();
+    }
+    if (!user_data->fixed_point && user_data->channels.size() == 3)
     {
         // Revert to BGR.
         cv::Mat hsv;
@@ -64,6 +81,9 @@ void do_the_work(UserData *user_data)
     }
     if (user_data->interactive)
     {
+        const double ms = 1000.0 * (cv::getTickCount() - t0) / cv::getTickFrequency();
+        std::cout << "Enhanced in " << ms << " ms"
+                  << (reused ? " (blur reused)." : ".") << std::endl;
         cv::imshow("OUTPUT", user_data->out);
         cv::imshow("UNSHARP MASK", user_data->unsharp_mask);
     }
@@ -112,7 +132,8 @@ void on_change_f(int v, void *user_data_)
 {
     UserData *user_data = static_cast<UserData *>(user_data_);
     user_data->f = v;
-    std::cout << "Setting filter type to " << (v == 0 ? "box" : "gaussian")
+    std::cout << "Setting filter type to "
+              << (v == 0 ? "box" : (v == 1 ? "gaussian" : "recursive gaussian"))
               << std::endl;
     do_the_work(user_data);
 }
@@ -160,9 +181,23 @@ int main(int argc, char *const *argv)
             std::cerr << "Error: g must be in [0.0, 10.0]." << std::endl;
             return EXIT_FAILURE;
         }
+        const double fft_ratio = parser.get<double>("fft_ratio");
+        if (fft_ratio <= 0.0)
+        {
+            std::cerr << "Error: fft_ratio must be >0." << std::endl;
+            return EXIT_FAILURE;
+        }
+        fsiv_set_fft_cost_ratio(fft_ratio);
         user_data.f = parser.get<int>("f");
         user_data.circular = parser.has("c");
         user_data.interactive = parser.has("i");
+        user_data.fixed_point = parser.has("x");
+        if (user_data.f < 0 || user_data.f > (user_data.fixed_point ? 1 : 2))
+        {
+            std::cerr << "Error: filter type must be in [0, "
+                      << (user_data.fixed_point ? 1 : 2) << "]." << std::endl;
+            return EXIT_FAILURE;
+        }
 
         cv::String input_n = parser.get<cv::String>("@input");
         cv::String output_n = parser.get<cv::String>("@output");
@@ -180,9 +215,21 @@ int main(int argc, char *const *argv)
             return EXIT_FAILURE;
         }
 
-        in.convertTo(user_data.in, CV_32F, 1.0 / 255.0);
+        if (user_data.fixed_point)
+        {
+            if (in.depth() != CV_8U || in.channels() > 4)
+            {
+                std::cerr << "Error: fixed point mode needs an 8-bit image." << std::endl;
+                return EXIT_FAILURE;
+            }
+            // No conversion to float is needed.
+            user_data.in = in;
+        }
+        else
+            in.convertTo(user_data.in, CV_32F, 1.0 / 255.0);
 
-        if (user_data.in.channels() == 3)
+        // In fixed point mode the channels are processed interleaved.
+        if (!user_data.fixed_point && user_data.in.channels() == 3)
         {
             cv::Mat hsv;
             cv::cvtColor(user_data.in, hsv, cv::COLOR_BGR2HSV);
@@ -191,6 +238,8 @@ int main(int argc, char *const *argv)
         }
         else
             user_data.luma = user_data.in;
+        if (!user_data.fixed_point)
+            user_data.session.set_image(user_data.luma);
 
         int k = 0;
 
@@ -203,7 +252,8 @@ int main(int argc, char *const *argv)
             cv::createTrackbar("R", "OUTPUT", &user_data.r, std::min(in.rows, in.cols) / 2 - 1, on_change_r, &user_data);
             int g_int = static_cast<int>(std::min(10.0, user_data.g * 10.0));
             cv::createTrackbar("G", "OUTPUT", &g_int, 100, on_change_g, &user_data);
-            cv::createTrackbar("Filter", "OUTPUT", &user_data.f, 1, on_change_f, &user_data);
+            cv::createTrackbar("Filter", "OUTPUT", &user_data.f, user_data.fixed_point ? 1 : 2,
+                               on_change_f, &user_data);
             cv::createTrackbar("Circular", "OUTPUT", &user_data.circular, 1, on_change_c, &user_data);
             do_the_work(&user_data);
             k = cv::waitKey(0) & 0xff;
@@ -213,8 +263,9 @@ int main(int argc, char *const *argv)
 
         if (k != 27)
         {
-            cv::Mat out;
-            user_data.out.convertTo(out, CV_8U, 255.0);
+            cv::Mat out = user_data.out;
+            if (out.depth() != CV_8U)
+                user_data.out.convertTo(out, CV_8U, 255.0);
             cv::imwrite(output_n, out);
         }
     }
@@ -0,0 +1,272 @@
+/**
+ * @file usm_fixed.cpp
+ * @brief Unsharp mask enhance of 8-bit images with integer arithmetic.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include "usm_fixed.hpp"
+#include "common_code.hpp"
+#include "convolution.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <opencv2/core/utility.hpp>
+
+// Fractional bits of the Gaussian kernel coefficients.
+static const int KERNEL_BITS = 16;
+// Fractional bits of the blurred values.
+static const int BLUR_BITS = 8;
+// Fractional bits of the gain. (255<<BLUR_BITS)*(10<<GAIN_BITS) fits in 32 bits.
+static const int GAIN_BITS = 11;
+
+/**
+ * @brief Map an index of the expanded image to the source image.
+ * @return the source index, or -1 for a zero border.
+ */
+static inline int border_index(int i, int n, bool circular)
+{
+    if (i >= 0 && i < n)
+        return i;
+    if (!circular)
+        return -1;
+    i %= n;
+    return i < 0 ? i + n : i;
+}
+
+/**
+ * @brief Copy an image row to a buffer extended r pixels at both sides.
+ * @param src is the row.
+ * @param cols is the number of pixels of the row.
+ * @param cn is the number of channels.
+ * @param r is the extension.
+ * @param circular if the border wraps around instead of being zero.
+ * @param ext is the output buffer, with (cols+2r)*cn values.
+ */
+static void extend_row(const uchar *src, int cols, int cn, int r, bool circular,
+                       uchar *ext)
+{
+    std::copy(src, src + cols * cn, ext + r * cn);
+    for (int x = -r; x < 0; ++x)
+    {
+        const int left = border_index(x, cols, circular);
+        const int right = border_index(cols - 1 - x, cols, circular);
+        for (int c = 0; c < cn; ++c)
+        {
+            ext[(x + r) * cn + c] = left < 0 ? 0 : src[left * cn + c];
+            ext[(cols - 1 - x + r) * cn + c] = right < 0 ? 0 : src[right * cn + c];
+        }
+    }
+}
+
+/**
+ * @brief Get the integer Gaussian kernel.
+ *
+ * The 1D factor of fsiv_create_gaussian_filter(r) quantized to KERNEL_BITS.
+ * The central coefficient absorbs the rounding, so the kernel sums exactly
+ * 1<<KERNEL_BITS.
+ */
+static std::vector<uint32_t> gaussian_kernel(int r)
+{
+    cv::Mat col, row;
+    const bool separable = fsiv_separate_filter(fsiv_create_gaussian_filter(r), col, row);
+    CV_Assert(separable);
+    const double sum = cv::sum(row)[0];
+    std::vector<uint32_t> k(row.cols);
+    int64_t total = 0;
+    for (int i = 0; i < row.cols; ++i)
+    {
+        k[i] = uint32_t(cvRound(row.at<float>(i) / sum * (1 << KERNEL_BITS)));
+        total += k[i];
+    }
+    k[r] = uint32_t(int64_t(k[r]) + (int64_t(1) << KERNEL_BITS) - total);
+    return k;
+}
+
+/**
+ * @brief Blur with the Gaussian kernel.
+ * @return the blurred values with BLUR_BITS fractional bits (CV_32SC(cn)).
+ */
+static cv::Mat gaussian_blur(const cv::Mat &in, int r, bool circular)
+{
+    const int cn = in.channels();
+    const int n = in.cols * cn;
+    const std::vector<uint32_t> k = gaussian_kernel(r);
+    const int ksize = int(k.size());
+
+    // Horizontal pass: 8-bit values times Q16 coefficients, rounded to Q8 so
+    // they fit in 16 bits.
+    cv::Mat h(in.rows, in.cols, CV_16UC(cn));
+    cv::parallel_for_(cv::Range(0, in.rows), [&](const cv::Range &range)
+    {
+        std::vector<uchar> ext((in.cols + 2 * r) * cn);
+        std::vector<uint32_t> acc(n);
+        for (int y = range.start; y < range.end; ++y)
+        {
+            extend_row(in.ptr<uchar>(y), in.cols, cn, r, circular, ext.data());
+            std::fill(acc.begin(), acc.end(), 0u);
+            for (int i = 0; i < ksize; ++i)
+            {
+                const uint32_t kv = k[i];
+                const uchar *s = ext.data() + i * cn;
+                for (int x = 0; x < n; ++x)
+                    acc[x] += kv * s[x];
+            }
+            ushort *dst = h.ptr<ushort>(y);
+            const int shift = KERNEL_BITS - BLUR_BITS;
+            for (int x = 0; x < n; ++x)
+                dst[x] = ushort((acc[x] + (1u << (shift - 1))) >> shift);
+        }
+    });
+
+    // Vertical pass along whole rows: Q8 values times Q16 coefficients fit in
+    // 32 unsigned bits.
+    cv::Mat ret_v(in.rows, in.cols, CV_32SC(cn));
+    cv::parallel_for_(cv::Range(0, in.rows), [&](const cv::Range &range)
+    {
+        std::vector<uint32_t> acc(n);
+        for (int y = range.start; y < range.end; ++y)
+        {
+            std::fill(acc.begin(), acc.end(), 0u);
+            for (int i = 0; i < ksize; ++i)
+            {
+                const int sy = border_index(y + i - r, in.rows, circular);
+                if (sy < 0)
+                    continue;
+                const uint32_t kv = k[i];
+                const ushort *s = h.ptr<ushort>(sy);
+                for (int x = 0; x < n; ++x)
+                    acc[x] += kv * s[x];
+            }
+            int *dst = ret_v.ptr<int>(y);
+            for (int x = 0; x < n; ++x)
+                dst[x] = int((acc[x] + (1u << (KERNEL_BITS - 1))) >> KERNEL_BITS);
+        }
+    });
+    return ret_v;
+}
+
+/**
+ * @brief Blur with the box filter using integer running sums.
+ * @return the blurred values with BLUR_BITS fractional bits (CV_32SC(cn)).
+ */
+static cv::Mat box_blur(const cv::Mat &in, int r, bool circular)
+{
+    const int cn = in.channels();
+    const int n = in.cols * cn;
+    const int k = 2 * r + 1;
+
+    // Horizontal window sums.
+    cv::Mat h(in.rows, in.cols, CV_32SC(cn));
+    cv::parallel_for_(cv::Range(0, in.rows), [&](const cv::Range &range)
+    {
+        std::vector<uchar> ext((in.cols + 2 * r) * cn);
+        for (int y = range.start; y < range.end; ++y)
+        {
+            extend_row(in.ptr<uchar>(y), in.cols, cn, r, circular, ext.data());
+            int *dst = h.ptr<int>(y);
+            for (int c = 0; c < cn; ++c)
+            {
+                int sum = 0;
+                for (int x = 0; x < k; ++x)
+                    sum += ext[x * cn + c];
+                dst[c] = sum;
+            }
+            for (int x = cn; x < n; ++x)
+                dst[x] = dst[x - cn] + ext[x + (k - 1) * cn] - ext[x - cn];
+        }
+    });
+
+    // Vertical window sums by column ranges, scaled by 1/k^2 to Q8 with a
+    // 32 bits reciprocal.
+    const int64_t inv = std::llround(double(int64_t(1) << (32 + BLUR_BITS)) / (double(k) * k));
+    cv::Mat ret_v(in.rows, in.cols, CV_32SC(cn));
+    cv::parallel_for_(cv::Range(0, n), [&](const cv::Range &range)
+    {
+        const int x0 = range.start;
+        const int m = range.end - range.start;
+        std::vector<int> sums(m, 0);
+        for (int y = -r; y <= r; ++y)
+        {
+            const int sy = border_index(y, in.rows, circular);
+            if (sy < 0)
+                continue;
+            const int *src = h.ptr<int>(sy) + x0;
+            for (int x = 0; x < m; ++x)
+                sums[x] += src[x];
+        }
+        for (int y = 0; y < in.rows; ++y)
+        {
+            if (y > 0)
+            {
+                const int enter = border_index(y + r, in.rows, circular);
+                const int leave = border_index(y - r - 1, in.rows, circular);
+                if (enter >= 0)
+                {
+                    const int *src = h.ptr<int>(enter) + x0;
+                    for (int x = 0; x < m; ++x)
+                        sums[x] += src[x];
+                }
+                if (leave >= 0)
+                {
+                    const int *src = h.ptr<int>(leave) + x0;
+                    for (int x = 0; x < m; ++x)
+                        sums[x] -= src[x];
+                }
+            }
+            int *dst = ret_v.ptr<int>(y) + x0;
+            for (int x = 0; x < m; ++x)
+                dst[x] = int((sums[x] * inv + (int64_t(1) << 31)) >> 32);
+        }
+    });
+    return ret_v;
+}
+
+cv::Mat
+fsiv_usm_enhance_u8(cv::Mat const &in, double g, int r, int filter_type,
+                    bool circular, cv::Mat *unsharp_mask)
+{
+    CV_Assert(!in.empty());
+    CV_Assert(in.depth() == CV_8U && in.channels() <= 4);
+    CV_Assert(r > 0);
+    CV_Assert(filter_type >= 0 && filter_type <= 1);
+    CV_Assert(g >= 0.0 && g <= 10.0);
+
+    const cv::Mat blur = (filter_type == 0) ? box_blur(in, r, circular)
+                                            : gaussian_blur(in, r, circular);
+    const int n = in.cols * in.channels();
+    const int gain = cvRound(g * (1 << GAIN_BITS));
+    cv::Mat ret_v(in.size(), in.type());
+    if (unsharp_mask != nullptr)
+        unsharp_mask->create(in.size(), in.type());
+    cv::parallel_for_(cv::Range(0, in.rows), [&](const cv::Range &range)
+    {
+        for (int y = range.start; y < range.end; ++y)
+        {
+            const uchar *src = in.ptr<uchar>(y);
+            const int *b = blur.ptr<int>(y);
+            uchar *dst = ret_v.ptr<uchar>(y);
+            // out = in + g*(in - blur)
+            for (int x = 0; x < n; ++x)
+            {
+                const int detail = (int(src[x]) << BLUR_BITS) - b[x];
+                const int v = src[x] + ((gain * detail + (1 << (BLUR_BITS + GAIN_BITS - 1))) >>
+                                        (BLUR_BITS + GAIN_BITS));
+                dst[x] = cv::saturate_cast<uchar>(v);
+            }
+            if (unsharp_mask != nullptr)
+            {
+                uchar *m = unsharp_mask->ptr<uchar>(y);
+                for (int x = 0; x < n; ++x)
+                    m[x] = cv::saturate_cast<uchar>((b[x] + (1 << (BLUR_BITS - 1))) >> BLUR_BITS);
+            }
+        }
+    });
+
+    CV_Assert(ret_v.type() == in.type());
+    CV_Assert(ret_v.size() == in.size());
+    return ret_v;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file usm_session.cpp
+ * @brief Unsharp mask enhance reusing the blur while only the gain changes.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#include "usm_session.hpp"
+#include "common_code.hpp"
+#include "convolution.hpp"
+
+UsmSession::UsmSession()
+    : r_(0), filter_type_(0), circular_(false), reused_(false)
+{
+}
+
+void UsmSession::set_image(const cv::Mat &in)
+{
+    CV_Assert(in.type() == CV_32FC1);
+    in_ = in;
+    mask_.release();
+    reused_ = false;
+}
+
+cv::Mat UsmSession::apply(double g, int r, int filter_type, bool circular,
+                          cv::Mat *unsharp_mask)
+{
+    CV_Assert(!empty());
+    cv::Mat ret_v;
+    reused_ = !mask_.empty() && r == r_ && filter_type == filter_type_ &&
+              circular == circular_;
+    if (reused_)
+        // The same float combination as the fused paths of fsiv_usm_enhance.
+        ret_v = fsiv_usm_combine(in_, mask_, g);
+    else
+    {
+        ret_v = fsiv_usm_enhance(in_, g, r, filter_type, circular, &mask_);
+        r_ = r;
+        filter_type_ = filter_type;
+        circular_ = circular;
+    }
+    if (unsharp_mask != nullptr)
+        mask_.copyTo(*unsharp_mask);
+    return ret_v;
+}
+
+bool UsmSession::empty() const
+{
+    return in_.empty();
+}
+
+bool UsmSession::blur_was_reused() const
+{
+    return reused_;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file usm_session.hpp
+ * @brief Unsharp mask enhance reusing the blur while only the gain changes.
+ * @version 0.1
+ * @date 2024-09-19
+ *
+ * @copyright Copyright (c) 2024-
+ *
+ */
+#pragma once
+#include <opencv2/core.hpp>
+
+/**
+ * @brief Keep the blurred image to enhance an image with several gains.
+ *
+ * The unsharp mask only depends on the image, the radius, the filter type and
+ * the expansion type, so it is kept between calls to apply(). When only the
+ * gain changes, apply() just combines the image and the kept mask with
+ * fsiv_usm_combine(), which is what an interactive change of the gain needs.
+ *
+ * The expanded image is not kept: the blur is filtered with virtual borders,
+ * so it is never built.
+ */
+class UsmSession
+{
+public:
+    /**
+     * @brief Create an empty session.
+     */
+    UsmSession();
+
+    /**
+     * @brief Set the image to enhance, discarding the kept blur.
+     * @param in is the input image.
+     * @pre in.type()==CV_32FC1
+     */
+    void set_image(const cv::Mat &in);
+
+    /**
+     * @brief Enhance the image.
+     * @param g is the enhance's gain.
+     * @param r is the window's radius.
+     * @param filter_type specifies which filter to use (see fsiv_usm_enhance).
+     * @param circular if it is true, use circular convolution.
+     * @param unsharp_mask if not nullptr, output the unsharp mask.
+     * @return the same image than fsiv_usm_enhance(in, g, r, filter_type, circular),
+     *         which combines in float as fsiv_usm_combine() unless the virtual
+     *         borders are disabled (see fsiv_set_virtual_borders).
+     * @pre !empty()
+     */
+    cv::Mat apply(double g, int r, int filter_type, bool circular,
+                  cv::Mat *unsharp_mask = nullptr);
+
+    /**
+     * @brief Check if an image was set.
+     */
+    bool empty() const;
+
+    /**
+     * @brief Check if the last apply() reused the kept blur.
+     */
+    bool blur_was_reused() const;
+
+protected:
+    cv::Mat in_;        // input image.
+    cv::Mat mask_;      // blurred image for the kept parameters.
+    int r_;
+    int filter_type_;
+    bool circular_;
+    bool reused_;
+};